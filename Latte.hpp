@@ -14,31 +14,105 @@
 #include <array>
 #include <limits>
 #include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <functional>
+#include <condition_variable>
+#include <deque>
+#include <utility>
+#include <charconv>
+#include <string_view>
 
 #if defined(_MSC_VER)
 #include <intrin.h>
 #else
 #include <x86intrin.h>
+#include <cpuid.h>
 #endif
 
-#define LATTE_PULSE(id_str) \
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Highest probe level compiled in: probes above it are no-ops (0 removes every probe). Probes default to level 1
+#ifndef LATTE_LEVEL
+#define LATTE_LEVEL 3
+#endif
+
+// 1: Start/Stop also aggregate inclusive/self time per (parent, ID) edge of the nesting stack (report CALL TREE section)
+#ifndef LATTE_CALL_TREE
+#define LATTE_CALL_TREE 0
+#endif
+
+#define LATTE_PULSE(id_str) LATTE_PULSE_AT(1, id_str)
+
+#define LATTE_PULSE_AT(level, id_str) \
+do { \
+  if constexpr ((level) <= LATTE_LEVEL) { \
+    static thread_local Latte::RingBuffer* _l_rb = nullptr; \
+    static thread_local uint64_t _l_last = 0; \
+    if (__builtin_expect(!_l_rb, 0)) { \
+      _l_rb = Latte::Internal::GetBuffer(id_str); \
+      _l_last = Latte::Intrinsic::RDTSC(); \
+    } else if (__builtin_expect(_l_rb->sample_every.load(std::memory_order_relaxed) <= 1, 1)) { \
+      uint64_t _l_now = Latte::Intrinsic::RDTSC(); \
+      if (__builtin_expect(_l_last != 0, 1)) { /* 0: stale after 1-in-N sampling, first gap discarded */ \
+        if (__builtin_expect(_l_rb->stamps != nullptr, 0)) _l_rb->StoreStamp(_l_now); \
+        _l_rb->push(_l_now - _l_last, Latte::Internal::CALIB_KEY_PULSE); \
+      } \
+      _l_last = _l_now; \
+    } else { \
+      Latte::Internal::SampledPulse(_l_rb, _l_last); \
+    } \
+  } \
+} while(0)
+
+// Non-timing metric (queue depth, batch size, ...): value recorded as is, ring bound once per call site and thread
+#define LATTE_VALUE(id_str, value) LATTE_VALUE_AT(1, id_str, value)
+
+#define LATTE_VALUE_AT(level, id_str, value) \
 do { \
-  static thread_local Latte::RingBuffer* _l_rb = nullptr; \
-  static thread_local uint64_t _l_last = 0; \
-  if (__builtin_expect(!_l_rb, 0)) { \
-    _l_rb = Latte::Internal::GetBuffer(id_str); \
-    _l_last = Latte::Intrinsic::RDTSC(); \
-  } else { \
-    uint64_t _l_now = Latte::Intrinsic::RDTSC(); \
-    _l_rb->push(_l_now - _l_last, Latte::Internal::CALIB_KEY_PULSE); \
-    _l_last = _l_now; \
+  if constexpr ((level) <= LATTE_LEVEL) { \
+    static thread_local Latte::RingBuffer* _l_rb = nullptr; \
+    if (__builtin_expect(!_l_rb, 0)) _l_rb = Latte::Internal::GetBuffer(id_str); \
+    Latte::Internal::PushValue(_l_rb, static_cast<uint64_t>(value)); \
   } \
 } while(0)
 
+#define LATTE_CONCAT_(a, b) a##b
+#define LATTE_CONCAT(a, b) LATTE_CONCAT_(a, b)
+
+// RAII probe for the enclosing block: buffer bound once per call site and thread, no Start/Stop stack
+#define LATTE_SCOPE(mode, id_str) LATTE_SCOPE_AT(1, mode, id_str)
+
+#define LATTE_SCOPE_AT(level, mode, id_str) \
+  Latte::Scope<Latte::Mode::mode, level> LATTE_CONCAT(_l_scope_, __LINE__)([]() -> Latte::RingBuffer* { \
+    static thread_local Latte::RingBuffer* _l_rb = nullptr; \
+    if (__builtin_expect(!_l_rb, 0)) _l_rb = Latte::Internal::GetBuffer(id_str); \
+    return _l_rb; \
+  })
+
+// Registers id_str once per call site and yields a dense Latte::Slot (optional Latte::IdOptions)
+#define LATTE_ID(id_str, ...) \
+  ([]() -> const Latte::Slot& { static const Latte::Slot _l_slot = Latte::Register(id_str, ##__VA_ARGS__); return _l_slot; }())
+
 namespace Latte {
 using ID = const char*;
 using Cycles = uint64_t;
 constexpr size_t MAX_ACTIVE_SLOTS = 64;
+constexpr size_t MAX_REGISTERED_IDS = 1024; // dense slot table per thread
+constexpr size_t MAX_CALL_NODES = 1024;     // LATTE_CALL_TREE: distinct call paths per thread
+constexpr size_t PMU_COUNTERS = 4;          // Latte::Pmu: hardware counters read per Start/Stop
 
 constexpr size_t BUFFER_PWR = 16;
 constexpr size_t MAX_SAMPLES = 1 << BUFFER_PWR; // 65536
@@ -48,20 +122,51 @@ struct Intrinsic {
   __attribute__((always_inline)) static inline Cycles RDTSC() { return __rdtsc(); }
   __attribute__((always_inline)) static inline Cycles RDTSCP() { unsigned int aux; return __rdtscp(&aux); }
   __attribute__((always_inline)) static inline Cycles RDTSCP_LFENCE() { _mm_lfence(); unsigned int aux; return __rdtscp(&aux); }
+  // Same reads, keeping IA32_TSC_AUX (Linux: cpu | node << 12)
+  __attribute__((always_inline)) static inline Cycles RDTSCP_AUX(unsigned int& aux) { return __rdtscp(&aux); }
+  __attribute__((always_inline)) static inline Cycles RDTSCP_LFENCE_AUX(unsigned int& aux) { _mm_lfence(); return __rdtscp(&aux); }
+  // Asymmetric pair reads: the start read waits for earlier instructions, the stop read for the measured ones,
+  // and the trailing fences keep later instructions from starting before the read
+  __attribute__((always_inline)) static inline Cycles LFENCE_RDTSC() { _mm_lfence(); return __rdtsc(); }
+  __attribute__((always_inline)) static inline Cycles LFENCE_RDTSC_LFENCE() { _mm_lfence(); const Cycles t = __rdtsc(); _mm_lfence(); return t; }
+  __attribute__((always_inline)) static inline Cycles RDTSCP_THEN_LFENCE() { unsigned int aux; const Cycles t = __rdtscp(&aux); _mm_lfence(); return t; }
+  __attribute__((always_inline)) static inline Cycles RDTSCP_AUX_LFENCE(unsigned int& aux) { const Cycles t = __rdtscp(&aux); _mm_lfence(); return t; }
 };
 
-enum class Mode : uint8_t { Fast = 0, Mid = 1, Hard = 2 };
+// Start / Stop reads: Fast rdtsc / rdtsc, Mid rdtscp / rdtscp, Hard lfence;rdtscp / lfence;rdtscp,
+// Lean lfence;rdtsc / rdtscp;lfence, Strict lfence;rdtsc;lfence / rdtscp;lfence (nothing crosses either read)
+enum class Mode : uint8_t { Fast = 0, Mid = 1, Hard = 2, Lean = 3, Strict = 4 };
+constexpr size_t MODE_COUNT = 5;
 
 namespace Internal {
 constexpr uint8_t CALIB_KEY_UNSET = 0xFF;
 constexpr uint8_t CALIB_KEY_MIXED = 0xFE;
+constexpr uint8_t CALIB_KEY_VALUE = 0xFD; // Latte::Record: raw values, no calibration offset (>= CALIB_KEY_COUNT)
 constexpr uint8_t CALIB_KEY_PULSE = 9;
-constexpr size_t  CALIB_KEY_COUNT = 10;
+constexpr size_t  CALIB_KEY_COUNT = 10 + MODE_COUNT * MODE_COUNT - 9;
+
+// Fast/Mid/Hard pairs keep keys 0..8 and PULSE 9 (traces and rings written before Lean/Strict read the same);
+// pairs whose highest mode is m >= 3 follow in layers of 2m + 1
+constexpr uint8_t PairKey(size_t s, size_t e) {
+  if (s < 3 && e < 3) return (uint8_t)(s * 3 + e);
+  const size_t m = (s > e) ? s : e;
+  return (uint8_t)(10 + (m * m - 9) + ((s == m) ? e : m + 1 + s));
+}
+
+inline constexpr std::array<uint8_t, MODE_COUNT * MODE_COUNT> CALIB_KEYS = []() {
+  std::array<uint8_t, MODE_COUNT * MODE_COUNT> k{};
+  for (size_t i = 0; i < k.size(); ++i) k[i] = PairKey(i / MODE_COUNT, i % MODE_COUNT);
+  return k;
+}();
 
 __attribute__((always_inline)) static inline uint8_t CalibKey(uint8_t start_mode, uint8_t stop_mode) {
-  return (start_mode < 3 && stop_mode < 3) ? static_cast<uint8_t>(start_mode * 3 + stop_mode) : CALIB_KEY_UNSET;
+  return (start_mode < MODE_COUNT && stop_mode < MODE_COUNT) ? CALIB_KEYS[start_mode * MODE_COUNT + stop_mode] : CALIB_KEY_UNSET;
 }
 
+// Modes whose Start read returns TSC_AUX (migration check at Stop)
+constexpr uint32_t CORE_AT_START = (1u << (unsigned)Mode::Mid) | (1u << (unsigned)Mode::Hard);
+constexpr bool CoreAtStart(Mode m) { return (CORE_AT_START >> (unsigned)m) & 1; }
+
 __attribute__((always_inline)) static inline void LFENCE() {
 #if defined(_MSC_VER)
   _mm_lfence();
@@ -70,25 +175,116 @@ __attribute__((always_inline)) static inline void LFENCE() {
 #endif
 }
 
-// Calibration labels (single address across TUs)
-inline constexpr char CALIB_FxF[] = "FxF";
-inline constexpr char CALIB_FxM[] = "FxM";
-inline constexpr char CALIB_FxH[] = "FxH";
-inline constexpr char CALIB_MxF[] = "MxF";
-inline constexpr char CALIB_MxM[] = "MxM";
-inline constexpr char CALIB_MxH[] = "MxH";
-inline constexpr char CALIB_HxF[] = "HxF";
-inline constexpr char CALIB_HxM[] = "HxM";
-inline constexpr char CALIB_HxH[] = "HxH";
+inline void CpuId(uint32_t leaf, uint32_t sub, uint32_t r[4]) {
+#if defined(_MSC_VER)
+  int v[4];
+  __cpuidex(v, (int)leaf, (int)sub);
+  for (int i = 0; i < 4; ++i) r[i] = (uint32_t)v[i];
+#else
+  __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// CPUID brand string (calibration cache key)
+inline std::string CpuBrand() {
+  uint32_t r[4];
+  CpuId(0x80000000, 0, r);
+  if (r[0] < 0x80000004) return "unknown";
+  char brand[49] = {};
+  for (uint32_t i = 0; i < 3; ++i) {
+    CpuId(0x80000002 + i, 0, r);
+    std::memcpy(brand + 16 * i, r, 16);
+  }
+  std::string b(brand);
+  b.erase(0, b.find_first_not_of(' '));
+  b.erase(b.find_last_not_of(' ') + 1);
+  return b;
+}
+
+// Nominal TSC rate reported by the platform, 0 when unknown. source names the origin
+inline double TscHzFromPlatform(const char** source) {
+  uint32_t r[4];
+  CpuId(0, 0, r);
+  const uint32_t max_leaf = r[0];
+
+  if (max_leaf >= 0x15) { // TSC / crystal ratio (EBX / EAX) x crystal Hz (ECX)
+    CpuId(0x15, 0, r);
+    if (r[0] && r[1] && r[2]) { *source = "cpuid.15"; return (double)r[2] * r[1] / r[0]; }
+  }
+
+  CpuId(1, 0, r);
+  if (r[2] & (1u << 31)) { // hypervisor: timing leaf 0x40000010, EAX = TSC kHz (VMware / KVM convention)
+    CpuId(0x40000000, 0, r);
+    if (r[0] >= 0x40000010) {
+      CpuId(0x40000010, 0, r);
+      if (r[0]) { *source = "hypervisor"; return r[0] * 1e3; }
+    }
+  }
+
+#if defined(__linux__)
+  if (FILE* f = std::fopen("/sys/devices/system/cpu/cpu0/tsc_freq_khz", "r")) {
+    unsigned long long khz = 0;
+    const bool ok = std::fscanf(f, "%llu", &khz) == 1 && khz > 0;
+    std::fclose(f);
+    if (ok) { *source = "sysfs"; return (double)khz * 1e3; }
+  }
+#endif
+
+  if (max_leaf >= 0x16) { // base frequency in MHz (Intel TSC ticks at base)
+    CpuId(0x16, 0, r);
+    if (r[0] & 0xFFFF) { *source = "cpuid.16"; return (double)(r[0] & 0xFFFF) * 1e6; }
+  }
+  return 0.0;
+}
+
+// CPUID 0x80000007 EDX[8]: TSC rate independent of P/C-states
+inline bool InvariantTsc() {
+  uint32_t r[4];
+  CpuId(0x80000000, 0, r);
+  if (r[0] < 0x80000007) return false;
+  CpuId(0x80000007, 0, r);
+  return (r[3] >> 8) & 1;
+}
+
+// Calibration labels (single address across TUs): CALIB_PAIR[start][stop] = "FxF", "FxM", ... "SxS"
+inline constexpr char MODE_LETTERS[MODE_COUNT + 1] = "FMHLS";
+inline constexpr char CALIB_PAIR[MODE_COUNT][MODE_COUNT][4] = {
+  {"FxF", "FxM", "FxH", "FxL", "FxS"},
+  {"MxF", "MxM", "MxH", "MxL", "MxS"},
+  {"HxF", "HxM", "HxH", "HxL", "HxS"},
+  {"LxF", "LxM", "LxH", "LxL", "LxS"},
+  {"SxF", "SxM", "SxH", "SxL", "SxS"},
+};
 inline constexpr char CALIB_PULSE[] = "PxP";
 
 struct CleanResult {
-  std::vector<double> values; // sorted
+  std::vector<double> values; // sorted (unless CleanData was asked not to)
   size_t bypass = 0; // OS bypass
   double cutoff = std::numeric_limits<double>::max();
 };
 
-inline CleanResult CleanData(const std::vector<double>& values) {
+// OS-bypass threshold from per-bucket maxima (Q3 + 3*IQR). Reorders bucket_maxes
+template <typename T>
+inline double BypassCutoff(std::vector<T>& bucket_maxes) {
+  double cutoff = std::numeric_limits<double>::max();
+
+  if (bucket_maxes.size() >= 4) {
+    const size_t n = bucket_maxes.size();
+    std::nth_element(bucket_maxes.begin(), bucket_maxes.begin() + n / 4, bucket_maxes.end());
+    const double q1 = (double)bucket_maxes[n / 4];
+    std::nth_element(bucket_maxes.begin() + n / 4, bucket_maxes.begin() + (n * 3) / 4, bucket_maxes.end());
+    const double q3 = (double)bucket_maxes[(n * 3) / 4];
+    const double iqr = q3 - q1;
+
+    cutoff = q3 + (3.0 * iqr);
+    if (iqr == 0) cutoff = q3 * 1.5;
+  } else if (!bucket_maxes.empty()) {
+    cutoff = (double)(*std::max_element(bucket_maxes.begin(), bucket_maxes.end())) * 1.5;
+  }
+  return cutoff;
+}
+
+inline CleanResult CleanData(const std::vector<double>& values, bool sort_values = true) {
   CleanResult out;
   if (values.empty()) return out;
 
@@ -108,21 +304,7 @@ inline CleanResult CleanData(const std::vector<double>& values) {
     bucket_maxes.push_back(b_max);
   }
 
-  double cutoff = std::numeric_limits<double>::max();
-
-  if (bucket_maxes.size() >= 4) {
-    std::sort(bucket_maxes.begin(), bucket_maxes.end());
-
-    const size_t n = bucket_maxes.size();
-    const double q1 = bucket_maxes[n / 4];
-    const double q3 = bucket_maxes[(n * 3) / 4];
-    const double iqr = q3 - q1;
-
-    cutoff = q3 + (3.0 * iqr);
-    if (iqr == 0) cutoff = q3 * 1.5;
-  } else if (!bucket_maxes.empty()) {
-    cutoff = (*std::max_element(bucket_maxes.begin(), bucket_maxes.end())) * 1.5;
-  }
+  const double cutoff = BypassCutoff(bucket_maxes);
 
   //Filter OS BYPASS
   out.values.reserve(values.size());
@@ -136,518 +318,4566 @@ inline CleanResult CleanData(const std::vector<double>& values) {
     out.bypass = 0;
   }
 
-  std::sort(out.values.begin(), out.values.end());
+  if (sort_values) std::sort(out.values.begin(), out.values.end());
   out.cutoff = cutoff;
   return out;
 }
 
+// Values at ascending sorted positions `ranks`, without sorting: nth_element over shrinking ranges.
+// Reorders v; out[i] == sorted(v)[ranks[i]]
+template <typename T>
+inline void SelectRanks(std::vector<T>& v, const std::vector<size_t>& ranks, std::vector<T>& out) {
+  out.clear();
+  size_t lo = 0;
+  for (size_t r : ranks) {
+    if (r >= lo) {
+      std::nth_element(v.begin() + lo, v.begin() + r, v.end());
+      lo = r + 1;
+    }
+    out.push_back(v[r]);
+  }
+}
+
+// Nearest-rank position of percentile p in [0, 100] for n > 0 samples
+inline size_t PercentileRank(double p, size_t n) {
+  const double r = std::ceil(p / 100.0 * (double)n);
+  return (r <= 1.0) ? 0 : std::min(n - 1, (size_t)r - 1);
+}
+
 inline double MedianFromSorted(const std::vector<double>& sorted) {
   if (sorted.empty()) return 0.0;
   const size_t n = sorted.size();
   return (n % 2 == 0) ? (sorted[n/2 - 1] + sorted[n/2]) / 2.0 : sorted[n/2];
 }
-    }
 
-struct alignas(64) RingBuffer {
-  Cycles data[MAX_SAMPLES];
-  size_t head = 0;
+#if !defined(LATTE_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define LATTE_SIMD_X86 1
+#endif
 
-  // 0xFF: unset/unknown, 0xFE: mixed
-  uint8_t calib_key = 0xFF;
+// Vector kernels over raw Cycles for the report pass. Scalar reference + AVX2 / AVX-512, picked once at runtime
+namespace Simd {
+struct Moments {
+  double s1 = 0, s2 = 0, s3 = 0; // sums of (x - shift)^k
+  Cycles min = std::numeric_limits<Cycles>::max();
+  Cycles max = 0;
+};
 
-  RingBuffer() {
-    std::memset(data, 0, sizeof(data));
-  }
+struct Kernels {
+  const char* name;
+  Cycles (*max)(const Cycles* v, size_t n);
+  void (*sub_clamp)(Cycles* v, size_t n, Cycles off); // v = max(v, off) - off
+  size_t (*compact_le)(const Cycles* in, size_t n, Cycles cutoff, Cycles* out); // keeps v <= cutoff, returns count
+  Moments (*moments)(const Cycles* v, size_t n, double shift);
+};
 
-  __attribute__((always_inline)) inline void push(Cycles val, uint8_t key) {
-    if (calib_key == 0xFF) calib_key = key;
-    else if (calib_key != key) calib_key = 0xFE;
+inline Cycles MaxScalar(const Cycles* v, size_t n) {
+  Cycles m = 0;
+  for (size_t i = 0; i < n; ++i) m = (v[i] > m) ? v[i] : m;
+  return m;
+}
 
-    data[head] = val;
-    head = (head + 1) & BUFFER_MASK; // wrapping
-  }
-};
+inline void SubClampScalar(Cycles* v, size_t n, Cycles off) {
+  for (size_t i = 0; i < n; ++i) v[i] = (v[i] > off) ? v[i] - off : 0;
+}
 
-struct ThreadStorage {
-  ID stack_ids[MAX_ACTIVE_SLOTS];
-  Cycles stack_starts[MAX_ACTIVE_SLOTS];
-  uint8_t stack_modes[MAX_ACTIVE_SLOTS]; // Latte::Mode encoded
-  size_t stack_ptr = 0;
+inline size_t CompactLeScalar(const Cycles* in, size_t n, Cycles cutoff, Cycles* out) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; ++i) {
+    out[k] = in[i];
+    k += (in[i] <= cutoff);
+  }
+  return k;
+}
 
-  // pointer comparison
-  std::map<ID, RingBuffer> history;
-  __attribute__((always_inline)) inline RingBuffer* GetOrAdd(ID id) {
-    return &history[id];
+inline void MomentsTail(const Cycles* v, size_t n, double shift, Moments& m) {
+  for (size_t i = 0; i < n; ++i) {
+    const double d = (double)v[i] - shift;
+    m.s1 += d;
+    m.s2 += d * d;
+    m.s3 += d * d * d;
+    m.min = std::min(m.min, v[i]);
+    m.max = std::max(m.max, v[i]);
   }
-};
+}
 
-class Manager {
-public:
-  std::mutex mutex;
-  std::vector<ThreadStorage*> thread_buffers;
+inline Moments MomentsScalar(const Cycles* v, size_t n, double shift) {
+  Moments m;
+  MomentsTail(v, n, shift, m);
+  return m;
+}
 
+inline const Kernels& Scalar() {
+  static const Kernels k = {"scalar", MaxScalar, SubClampScalar, CompactLeScalar, MomentsScalar};
+  return k;
+}
 
-  double cycles_per_ns = 1.0; //Default: Unknown
+#if defined(LATTE_SIMD_X86)
+// AVX2 has no unsigned 64-bit compare: flip the sign bit and use the signed one
+#define LATTE_AVX2 __attribute__((target("avx2")))
+#define LATTE_AVX512 __attribute__((target("avx512f,avx512dq")))
 
-  static Manager& Get() { static Manager instance; return instance; }
+LATTE_AVX2 inline __m256i GtU64(__m256i a, __m256i b) {
+  const __m256i s = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s));
+}
 
-  __attribute__((always_inline)) inline void EnsureCalibrated() {
-    std::call_once(calibrate_once, [&]() { Calibrate(); });
-  }
+// Exact for x < 2^52, single rounding above
+LATTE_AVX2 inline __m256d ToDouble(__m256i x) {
+  const __m256i lo = _mm256_blend_epi32(x, _mm256_castpd_si256(_mm256_set1_pd(0x1p52)), 0xAA);
+  const __m256i hi = _mm256_or_si256(_mm256_srli_epi64(x, 32), _mm256_castpd_si256(_mm256_set1_pd(0x1p84)));
+  const __m256d h = _mm256_sub_pd(_mm256_castsi256_pd(hi), _mm256_set1_pd(0x1p84 + 0x1p52));
+  return _mm256_add_pd(h, _mm256_castsi256_pd(lo));
+}
 
-  __attribute__((always_inline)) inline Cycles CalibrationOffset(uint8_t key) const {
-    if (key >= Internal::CALIB_KEY_COUNT) return 0;
-    if (!calib_valid[key]) return 0;
-    return calib_offsets[key];
+LATTE_AVX2 inline Cycles MaxAvx2(const Cycles* v, size_t n) {
+  __m256i m = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    m = _mm256_blendv_epi8(m, x, GtU64(x, m));
   }
+  alignas(32) Cycles lanes[4];
+  _mm256_store_si256((__m256i*)lanes, m);
+  return std::max({MaxScalar(lanes, 4), MaxScalar(v + i, n - i)});
+}
 
-  void Register(ThreadStorage* ts) {
-    std::lock_guard<std::mutex> lock(mutex);
-    thread_buffers.push_back(ts);
+LATTE_AVX2 inline void SubClampAvx2(Cycles* v, size_t n, Cycles off) {
+  const __m256i o = _mm256_set1_epi64x((long long)off);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    const __m256i under = GtU64(o, x);
+    _mm256_storeu_si256((__m256i*)(v + i), _mm256_andnot_si256(under, _mm256_sub_epi64(x, o)));
   }
+  SubClampScalar(v + i, n - i, off);
+}
 
-  // Non-blocking Data Extraction
-  // Returns all valid samples collected so far for a specific ID
-  std::vector<Cycles> ExtractRaw(ID id) {
-    std::vector<Cycles> output;
-    output.reserve(1024);
-
-    std::lock_guard<std::mutex> lock(mutex);
-    for (auto* ts : thread_buffers) {
-      auto it = ts->history.find(id);
-      if (it == ts->history.end()) continue;
-      RingBuffer& rb = it->second;
-
-      for (size_t i = 0; i < MAX_SAMPLES; ++i) {
-        Cycles v = rb.data[i];
-        if (v > 0) output.push_back(v);
+// Lane permutation per 4-bit keep mask: kept 64-bit lanes packed to the front
+struct CompactLut {
+  alignas(32) uint32_t idx[16][8];
+  constexpr CompactLut() : idx() {
+    for (int m = 0; m < 16; ++m) {
+      int k = 0;
+      for (int j = 0; j < 4; ++j) {
+        if (m & (1 << j)) { idx[m][2 * k] = 2 * j; idx[m][2 * k + 1] = 2 * j + 1; ++k; }
       }
     }
-    return output;
   }
-
-  void Calibrate(); //scroll down
-
-private:
-  std::once_flag calibrate_once;
-  std::array<Cycles, Internal::CALIB_KEY_COUNT> calib_offsets{};
-  std::array<bool, Internal::CALIB_KEY_COUNT> calib_valid{};
 };
+inline constexpr CompactLut COMPACT_LUT{};
 
-inline ThreadStorage* GetThreadStorage() {
-  static thread_local ThreadStorage* ts = nullptr;
-  if (__builtin_expect(!ts, 0)) {
-    ts = new ThreadStorage();
-    Manager::Get().Register(ts);
+// Full 4-lane stores write past the kept count but never past i + 4 <= n
+LATTE_AVX2 inline size_t CompactLeAvx2(const Cycles* in, size_t n, Cycles cutoff, Cycles* out) {
+  const __m256i c = _mm256_set1_epi64x((long long)cutoff);
+  size_t k = 0, i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+    const int keep = ~_mm256_movemask_pd(_mm256_castsi256_pd(GtU64(x, c))) & 0xF;
+    const __m256i perm = _mm256_load_si256((const __m256i*)COMPACT_LUT.idx[keep]);
+    _mm256_storeu_si256((__m256i*)(out + k), _mm256_permutevar8x32_epi32(x, perm));
+    k += (size_t)__builtin_popcount(keep);
   }
-  return ts;
+  return k + CompactLeScalar(in + i, n - i, cutoff, out + k);
 }
 
-namespace Internal {
-inline RingBuffer* GetBuffer(ID id) { return GetThreadStorage()->GetOrAdd(id); }
-    }
+LATTE_AVX2 inline Moments MomentsAvx2(const Cycles* v, size_t n, double shift) {
+  const __m256d sh = _mm256_set1_pd(shift);
+  __m256d s1 = _mm256_setzero_pd(), s2 = s1, s3 = s1;
+  __m256i mn = _mm256_set1_epi64x(-1), mx = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    mn = _mm256_blendv_epi8(mn, x, GtU64(mn, x));
+    mx = _mm256_blendv_epi8(mx, x, GtU64(x, mx));
+    const __m256d d = _mm256_sub_pd(ToDouble(x), sh);
+    const __m256d d2 = _mm256_mul_pd(d, d);
+    s1 = _mm256_add_pd(s1, d);
+    s2 = _mm256_add_pd(s2, d2);
+    s3 = _mm256_add_pd(s3, _mm256_mul_pd(d2, d));
+  }
+  alignas(32) double a1[4], a2[4], a3[4];
+  alignas(32) Cycles lmn[4], lmx[4];
+  _mm256_store_pd(a1, s1); _mm256_store_pd(a2, s2); _mm256_store_pd(a3, s3);
+  _mm256_store_si256((__m256i*)lmn, mn); _mm256_store_si256((__m256i*)lmx, mx);
 
-template <Mode M, Cycles (*TimeFunc)()>
-struct Recorder {
-  __attribute__((always_inline)) static inline void Start(ID id) {
-    ThreadStorage* ts = GetThreadStorage();
-    if (__builtin_expect(ts->stack_ptr < MAX_ACTIVE_SLOTS, 1)) {
-      ts->stack_starts[ts->stack_ptr] = TimeFunc();
-      ts->stack_ids[ts->stack_ptr] = id;
-      ts->stack_modes[ts->stack_ptr] = static_cast<uint8_t>(M);
-      ts->stack_ptr++;
-    }
+  Moments m;
+  for (int j = 0; j < 4; ++j) {
+    m.s1 += a1[j]; m.s2 += a2[j]; m.s3 += a3[j];
+    if (i) { m.min = std::min(m.min, lmn[j]); m.max = std::max(m.max, lmx[j]); }
   }
+  MomentsTail(v + i, n - i, shift, m);
+  return m;
+}
 
-  __attribute__((always_inline)) static inline Cycles Stop(ID /*id*/) {
-    Cycles end = TimeFunc();
-    ThreadStorage* ts = GetThreadStorage();
+inline const Kernels& Avx2() {
+  static const Kernels k = {"avx2", MaxAvx2, SubClampAvx2, CompactLeAvx2, MomentsAvx2};
+  return k;
+}
 
-    if (__builtin_expect(ts->stack_ptr > 0, 1)) {
-      ts->stack_ptr--;
-      Cycles delta = end - ts->stack_starts[ts->stack_ptr]; // raw latency
-      const uint8_t start_mode = ts->stack_modes[ts->stack_ptr];
-      const uint8_t stop_mode  = static_cast<uint8_t>(M);
-      const uint8_t key = Internal::CalibKey(start_mode, stop_mode);
-      ts->history[ts->stack_ids[ts->stack_ptr]].push(delta, key);
-      return delta;
-    }
-    return 0;
+// GCC's _mm512_undefined_* placeholders trip -Wuninitialized once inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+LATTE_AVX512 inline Cycles MaxAvx512(const Cycles* v, size_t n) {
+  __m512i m = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) m = _mm512_max_epu64(m, _mm512_loadu_si512(v + i));
+  const __mmask8 tail = (__mmask8)((1u << (n - i)) - 1);
+  m = _mm512_max_epu64(m, _mm512_maskz_loadu_epi64(tail, v + i));
+  return _mm512_reduce_max_epu64(m);
+}
+
+LATTE_AVX512 inline void SubClampAvx512(Cycles* v, size_t n, Cycles off) {
+  const __m512i o = _mm512_set1_epi64((long long)off);
+  for (size_t i = 0; i < n; i += 8) {
+    const __mmask8 k = (n - i >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << (n - i)) - 1);
+    const __m512i x = _mm512_maskz_loadu_epi64(k, v + i);
+    _mm512_mask_storeu_epi64(v + i, k, _mm512_sub_epi64(_mm512_max_epu64(x, o), o));
   }
-};
-namespace Fast { inline void Start(ID id) { Recorder<Mode::Fast, Intrinsic::RDTSC>::Start(id); } inline void Stop(ID id) { Recorder<Mode::Fast, Intrinsic::RDTSC>::Stop(id); } }
-namespace Mid  { inline void Start(ID id) { Recorder<Mode::Mid, Intrinsic::RDTSCP>::Start(id); } inline void Stop(ID id) { Recorder<Mode::Mid, Intrinsic::RDTSCP>::Stop(id); } }
-namespace Hard { inline void Start(ID id) { Recorder<Mode::Hard, Intrinsic::RDTSCP_LFENCE>::Start(id); } inline void Stop(ID id) { Recorder<Mode::Hard, Intrinsic::RDTSCP_LFENCE>::Stop(id); } }
+}
 
-inline void Manager::Calibrate() {
-  { // TIME CALIBRATION (cycles_per_ns)
-    auto t1 = std::chrono::high_resolution_clock::now();
-    Cycles c1 = Intrinsic::RDTSC();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    Cycles c2 = Intrinsic::RDTSC();
-    auto t2 = std::chrono::high_resolution_clock::now();
-    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
-    cycles_per_ns = (ns > 0.0) ? (double)(c2 - c1) / ns : 1.0;
+LATTE_AVX512 inline size_t CompactLeAvx512(const Cycles* in, size_t n, Cycles cutoff, Cycles* out) {
+  const __m512i c = _mm512_set1_epi64((long long)cutoff);
+  size_t k = 0;
+  for (size_t i = 0; i < n; i += 8) {
+    const __mmask8 valid = (n - i >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << (n - i)) - 1);
+    const __m512i x = _mm512_maskz_loadu_epi64(valid, in + i);
+    const __mmask8 keep = _mm512_mask_cmple_epu64_mask(valid, x, c);
+    _mm512_mask_compressstoreu_epi64(out + k, keep, x);
+    k += (size_t)__builtin_popcount(keep);
   }
+  return k;
+}
 
-  // PERMUTATION OVERHEAD
-  constexpr int WARMUP_ITERS = 10000; // naturally overwrite by circular buffer
-  const int iters = (int)MAX_SAMPLES + WARMUP_ITERS;
+LATTE_AVX512 inline Moments MomentsAvx512(const Cycles* v, size_t n, double shift) {
+  const __m512d sh = _mm512_set1_pd(shift);
+  __m512d s1 = _mm512_setzero_pd(), s2 = s1, s3 = s1;
+  __m512i mn = _mm512_set1_epi64(-1), mx = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512i x = _mm512_loadu_si512(v + i);
+    mn = _mm512_min_epu64(mn, x);
+    mx = _mm512_max_epu64(mx, x);
+    const __m512d d = _mm512_sub_pd(_mm512_cvtepu64_pd(x), sh);
+    const __m512d d2 = _mm512_mul_pd(d, d);
+    s1 = _mm512_add_pd(s1, d);
+    s2 = _mm512_add_pd(s2, d2);
+    s3 = _mm512_add_pd(s3, _mm512_mul_pd(d2, d));
+  }
+  Moments m;
+  m.s1 = _mm512_reduce_add_pd(s1);
+  m.s2 = _mm512_reduce_add_pd(s2);
+  m.s3 = _mm512_reduce_add_pd(s3);
+  if (i) { m.min = _mm512_reduce_min_epu64(mn); m.max = _mm512_reduce_max_epu64(mx); }
+  MomentsTail(v + i, n - i, shift, m);
+  return m;
+}
 
+inline const Kernels& Avx512() {
+  static const Kernels k = {"avx512", MaxAvx512, SubClampAvx512, CompactLeAvx512, MomentsAvx512};
+  return k;
+}
+#pragma GCC diagnostic pop
 
-  (void)GetThreadStorage(); // Force TLS init before sampling
+#undef LATTE_AVX2
+#undef LATTE_AVX512
+#endif
 
-  for (volatile int i = 0; i < iters; ++i) {
-    Internal::LFENCE();
-    Latte::Fast::Start(Internal::CALIB_FxF);
-    Latte::Fast::Stop(Internal::CALIB_FxF);
-    Internal::LFENCE();
+inline const Kernels& Get() {
+  static const Kernels& k = []() -> const Kernels& {
+#if defined(LATTE_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return Avx512();
+    if (__builtin_cpu_supports("avx2")) return Avx2();
+#endif
+    return Scalar();
+  }();
+  return k;
+}
+    }
 
-    Internal::LFENCE();
-    Latte::Fast::Start(Internal::CALIB_FxM);
-    Latte::Mid::Stop(Internal::CALIB_FxM);
-    Internal::LFENCE();
+// CleanData on raw Cycles: same cutoff, vector bucket-max and branchless compaction into `out`
+// maxes (optional): caller's scratch for the bucket maxima, reused across calls
+inline size_t CleanCycles(const std::vector<Cycles>& values, std::vector<Cycles>& out, double* cutoff_out = nullptr,
+                          std::vector<Cycles>* maxes = nullptr) {
+  const Simd::Kernels& K = Simd::Get();
+  const size_t BUCKET_SIZE = 1000;
+  const size_t n = values.size();
 
-    Internal::LFENCE();
-    Latte::Fast::Start(Internal::CALIB_FxH);
-    Latte::Hard::Stop(Internal::CALIB_FxH);
-    Internal::LFENCE();
+  std::vector<Cycles> local;
+  std::vector<Cycles>& bucket_maxes = maxes ? *maxes : local;
+  bucket_maxes.clear();
+  for (size_t i = 0; i < n; i += BUCKET_SIZE) {
+    const size_t end = std::min(i + BUCKET_SIZE, n);
+    if ((end - i) < BUCKET_SIZE / 2) continue;
+    bucket_maxes.push_back(K.max(values.data() + i, end - i));
+  }
 
-    Internal::LFENCE();
-    Latte::Mid::Start(Internal::CALIB_MxF);
-    Latte::Fast::Stop(Internal::CALIB_MxF);
-    Internal::LFENCE();
+  // v <= cutoff  <=>  v <= floor(cutoff) for integer v
+  const double cutoff = BypassCutoff(bucket_maxes);
+  if (cutoff_out) *cutoff_out = cutoff;
+  const Cycles c = (cutoff >= 0x1p64) ? std::numeric_limits<Cycles>::max() : (Cycles)std::floor(cutoff);
 
-    Internal::LFENCE();
-    Latte::Mid::Start(Internal::CALIB_MxM);
-    Latte::Mid::Stop(Internal::CALIB_MxM);
-    Internal::LFENCE();
+  out.resize(n);
+  out.resize(K.compact_le(values.data(), n, c, out.data()));
+  if (out.empty()) {
+    out = values;
+    return 0;
+  }
+  return n - out.size();
+}
+    }
 
-    Internal::LFENCE();
-    Latte::Mid::Start(Internal::CALIB_MxH);
-    Latte::Hard::Stop(Internal::CALIB_MxH);
-    Internal::LFENCE();
+// Dense handle for a registered ID (see LATTE_ID). index == NO_SLOT falls back to the pointer-keyed map
+struct Slot {
+  static constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+  uint32_t index = NO_SLOT;
+  ID name = nullptr;
+};
 
-    Internal::LFENCE();
-    Latte::Hard::Start(Internal::CALIB_HxF);
-    Latte::Fast::Stop(Internal::CALIB_HxF);
-    Internal::LFENCE();
+// Wide: 64-bit samples. Compact: 32-bit samples, larger values escape to a small side ring
+enum class Encoding : uint8_t { Wide = 0, Compact = 1 };
 
-    Internal::LFENCE();
-    Latte::Hard::Start(Internal::CALIB_HxM);
-    Latte::Mid::Stop(Internal::CALIB_HxM);
-    Internal::LFENCE();
+// Hardware counters for the Latte::Pmu recorder (Manager::pmu_events); user space only
+enum class PmuEvent : uint8_t { None = 0, CoreCycles, Instructions, CacheMisses, BranchMisses };
 
-    Internal::LFENCE();
-    Latte::Hard::Start(Internal::CALIB_HxH);
-    Latte::Hard::Stop(Internal::CALIB_HxH);
-    Internal::LFENCE();
-  }
+// Per-ID buffer layout, read when a thread first creates the buffer
+struct IdOptions {
+  size_t capacity = MAX_SAMPLES; // rounded up to a power of two
+  Encoding encoding = Encoding::Wide;
+  bool histogram = false;        // full-run log-linear histogram next to the ring (see Latte::Histogram)
+  bool cores = false;            // per-sample TSC_AUX (CPU/node) from Mid/Hard stops, for ReportOptions::breakdown
+  uint32_t sample_every = 1;     // record 1 in N Start/Stop pairs (or pulses); see also Latte::SetSampling
+  Cycles threshold = 0;          // raw Stop delta above which the thread's rings are captured (0: off); see Latte::SetThreshold
+  bool timestamps = false;       // LATTE_PULSE: absolute TSC per event, for gap/stall times in the PULSE report section
+};
 
-  // PULSE OVERHEAD
-  for (volatile int i = 0; i < iters; ++i) {
-    Internal::LFENCE();
-    Latte::Fast::Start(Internal::CALIB_PULSE);
-    LATTE_PULSE("xxxx");
-    Latte::Mid::Stop(Internal::CALIB_PULSE);
-    Internal::LFENCE();
-  }
+// Log-linear (HDR-style) bucketing: values < 64 exact, then 32 sub-buckets per power of two (<= 3.2% error)
+namespace Internal {
+constexpr size_t HIST_LINEAR = 64;
+constexpr size_t HIST_SUB = 32;
+constexpr size_t HIST_BUCKETS = HIST_LINEAR + (64 - 6) * HIST_SUB; // 1920
 
-  auto BUMED = [&](ID id) -> Cycles { // Median(Min(Bucket[1'000] ))
-    std::vector<Cycles> raw = ExtractRaw(id);
-    if (raw.empty()) return 0;
+__attribute__((always_inline)) static inline size_t HistIndex(uint64_t v) {
+  if (v < HIST_LINEAR) return (size_t)v;
+  const unsigned shift = (unsigned)(63 - __builtin_clzll(v)) - 5; // v >> shift in [32, 64)
+  return HIST_LINEAR + (shift - 1) * HIST_SUB + (size_t)((v >> shift) - HIST_SUB);
+}
 
-    constexpr size_t BUCKET = 1000;
-    const size_t full = (raw.size() / BUCKET) * BUCKET;
-    if (full == 0) {
-      return *std::min_element(raw.begin(), raw.end());
-    }
+inline uint64_t HistLow(size_t i) {
+  if (i < HIST_LINEAR) return i;
+  const size_t shift = (i - HIST_LINEAR) / HIST_SUB + 1;
+  return (uint64_t)(HIST_SUB + (i - HIST_LINEAR) % HIST_SUB) << shift;
+}
 
-    std::vector<Cycles> mins;
-    mins.reserve(full / BUCKET);
+inline uint64_t HistWidth(size_t i) { return (i < HIST_LINEAR) ? 1 : uint64_t(1) << ((i - HIST_LINEAR) / HIST_SUB + 1); }
 
-    for (size_t i = 0; i < full; i += BUCKET) {
-      Cycles m = std::numeric_limits<Cycles>::max();
-      for (size_t j = i; j < i + BUCKET; ++j) {
-        const Cycles v = raw[j];
-        if (v > 0 && v < m) m = v;
-      }
-      if (m != std::numeric_limits<Cycles>::max())
-        mins.push_back(m);
-    }
+// Per-(thread, id) counters: single writer, relaxed atomics so readers can merge while it records
+struct HistogramCounters {
+  std::atomic<uint64_t> counts[HIST_BUCKETS];
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> min{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> max{0};
 
-    if (mins.empty()) {
-      return *std::min_element(raw.begin(), raw.end());
+  __attribute__((always_inline)) static inline void Bump(std::atomic<uint64_t>& a, uint64_t by) {
+    a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed); // owner only: no RMW needed
+  }
+
+  __attribute__((always_inline)) inline void Record(uint64_t v) {
+    Bump(counts[HistIndex(v)], 1);
+    Bump(total, 1);
+    Bump(sum, v);
+    if (__builtin_expect(v < min.load(std::memory_order_relaxed), 0)) min.store(v, std::memory_order_relaxed);
+    if (__builtin_expect(v > max.load(std::memory_order_relaxed), 0)) max.store(v, std::memory_order_relaxed);
+  }
+};
     }
 
-    std::sort(mins.begin(), mins.end());
-    const size_t n = mins.size();
-    if (n & 1) return mins[n / 2];
+// Mergeable full-run distribution (plain copy of one or more HistogramCounters)
+struct Histogram {
+  std::vector<uint64_t> counts = std::vector<uint64_t>(Internal::HIST_BUCKETS, 0);
+  uint64_t total = 0;
+  uint64_t sum = 0;
+  uint64_t min = std::numeric_limits<uint64_t>::max();
+  uint64_t max = 0;
 
-    const unsigned __int128 a = mins[n / 2 - 1];
-    const unsigned __int128 b = mins[n / 2];
-    return (Cycles)((a + b + 1) / 2);
-  };
+  void Merge(const Internal::HistogramCounters& h) {
+    for (size_t i = 0; i < Internal::HIST_BUCKETS; ++i) counts[i] += h.counts[i].load(std::memory_order_relaxed);
+    total += h.total.load(std::memory_order_relaxed);
+    sum += h.sum.load(std::memory_order_relaxed);
+    min = std::min(min, h.min.load(std::memory_order_relaxed));
+    max = std::max(max, h.max.load(std::memory_order_relaxed));
+  }
 
+  void Merge(const Histogram& h) {
+    for (size_t i = 0; i < Internal::HIST_BUCKETS; ++i) counts[i] += h.counts[i];
+    total += h.total;
+    sum += h.sum;
+    min = std::min(min, h.min);
+    max = std::max(max, h.max);
+  }
 
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Fast, (uint8_t)Mode::Fast)] = BUMED(Internal::CALIB_FxF);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Fast, (uint8_t)Mode::Mid)]  = BUMED(Internal::CALIB_FxM);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Fast, (uint8_t)Mode::Hard)] = BUMED(Internal::CALIB_FxH);
+  // Back to empty, keeping the bucket storage
+  void Clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = sum = 0;
+    min = std::numeric_limits<uint64_t>::max();
+    max = 0;
+  }
 
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Mid,  (uint8_t)Mode::Fast)] = BUMED(Internal::CALIB_MxF);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Mid,  (uint8_t)Mode::Mid)]  = BUMED(Internal::CALIB_MxM);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Mid,  (uint8_t)Mode::Hard)] = BUMED(Internal::CALIB_MxH);
+  double Mean() const { return total ? (double)sum / (double)total : 0.0; }
 
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Hard, (uint8_t)Mode::Fast)] = BUMED(Internal::CALIB_HxF);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Hard, (uint8_t)Mode::Mid)]  = BUMED(Internal::CALIB_HxM);
-  calib_offsets[Internal::CalibKey((uint8_t)Mode::Hard, (uint8_t)Mode::Hard)] = BUMED(Internal::CALIB_HxH);
+  // p in [0, 100]; bucket midpoint, clamped to the exact min/max
+  double Percentile(double p) const {
+    if (total == 0) return 0.0;
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p / 100.0 * (double)total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Internal::HIST_BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen < rank) continue;
+      const double mid = (double)Internal::HistLow(i) + (double)(Internal::HistWidth(i) - 1) / 2.0;
+      return std::min((double)max, std::max((double)min, mid));
+    }
+    return (double)max;
+  }
+};
 
-  calib_offsets[Internal::CALIB_KEY_PULSE] = BUMED(Internal::CALIB_PULSE);
+namespace Internal {
+class Registry {
+public:
+  static Registry& Get() { static Registry instance; return instance; }
 
-  for (size_t i = 0; i < Internal::CALIB_KEY_COUNT; ++i) {
-    calib_valid[i] = true;
+  void Configure(ID name, const IdOptions& opts) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options[name] = opts;
+  }
+
+  IdOptions Options(ID name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = options.find(name);
+    return (it != options.end()) ? it->second : IdOptions{};
+  }
+
+  Slot Register(ID name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = indices.find(name);
+    if (it != indices.end()) return Slot{it->second, name};
+    if (indices.size() >= MAX_REGISTERED_IDS) return Slot{Slot::NO_SLOT, name}; // table full: ad-hoc fallback
+
+    const uint32_t index = static_cast<uint32_t>(indices.size());
+    indices.emplace(name, index);
+    names.push_back(name);
+    return Slot{index, name};
+  }
+
+  ID Name(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (index < names.size()) ? names[index] : nullptr;
+  }
+
+  // Ring generations: unique per created ring (never 0), so reader cursors notice a ring recreated at a reused address
+  uint64_t NextGeneration() { return generation.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+private:
+  std::mutex mutex;
+  std::atomic<uint64_t> generation{0};
+  std::map<ID, uint32_t> indices; // pointer comparison
+  std::vector<ID> names;
+  std::map<ID, IdOptions> options;
+};
+    }
+
+// Options only affect buffers created after the call (per thread, on first use)
+inline void Configure(ID name, const IdOptions& opts) { Internal::Registry::Get().Configure(name, opts); }
+
+inline Slot Register(ID name) { return Internal::Registry::Get().Register(name); }
+inline Slot Register(ID name, const IdOptions& opts) {
+  Configure(name, opts);
+  return Register(name);
+}
+
+namespace Parameter {
+enum Backing { Lazy, Populate, HugePage }; // ring memory: fault on first touch, pre-faulted, 2 MiB pages
+enum Unit { Cycle, Time };
+enum Data { Raw, Calibrated };
+enum Breakdown { Merged, PerThread, PerCore }; // report sub-rows under each ID (PerCore needs IdOptions::cores)
+enum Layout { Table, Plain, Csv, Json }; // report text: ANSI table, table without escapes, statistics rows only
+    }
+
+namespace Internal {
+constexpr size_t PAGE_BYTES = 4096;
+constexpr size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+constexpr size_t ARENA_CHUNK_BYTES = size_t(32) << 20; // 32 MiB virtual per chunk (64 default rings)
+
+// Calling thread's cpu and NUMA node (getcpu), -1 when unknown
+struct CpuNode { int cpu = -1; int node = -1; };
+inline CpuNode CurrentCpuNode() {
+  CpuNode r;
+#if defined(__linux__)
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) { r.cpu = (int)cpu; r.node = (int)node; }
+#endif
+  return r;
+}
+
+// Online NUMA nodes (highest id + 1 of /sys/devices/system/node/online), 1 when unknown
+inline int NumaNodes() {
+  static const int nodes = []() {
+    int n = 1;
+#if defined(__linux__)
+    if (FILE* f = std::fopen("/sys/devices/system/node/online", "r")) {
+      char buf[256] = {};
+      if (std::fgets(buf, sizeof(buf), f)) {
+        for (char* c = buf; *c;) { // "0", "0-3", "0,2-3"
+          char* end = c;
+          const long v = std::strtol(c, &end, 10);
+          if (end == c) { ++c; continue; }
+          n = std::max(n, (int)v + 1);
+          c = end;
+        }
+      }
+      std::fclose(f);
+    }
+#endif
+    return n;
+  }();
+  return nodes;
+}
+
+// Pages of [p, p + size) not faulted yet go to node (MPOL_PREFERRED, falls back when the node is full).
+// No-op on single-node machines, where first touch is already local
+inline bool PreferNode(void* p, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  if (node < 0 || node >= 64 || NumaNodes() <= 1) return false;
+  const unsigned long mask = 1UL << node;
+  return syscall(SYS_mbind, p, size, 1 /* MPOL_PREFERRED */, &mask, (unsigned long)64 + 1, 0) == 0;
+#else
+  (void)p; (void)size; (void)node;
+  return false;
+#endif
+}
+
+// Zeroed pages on the calling thread's node (ThreadStorage itself, so its stack/slot tables are not heap neighbours)
+inline void* MapLocal(size_t bytes) {
+#if defined(__linux__)
+  bytes = (bytes + PAGE_BYTES - 1) & ~(PAGE_BYTES - 1);
+  void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) throw std::bad_alloc();
+  PreferNode(p, bytes, CurrentCpuNode().node);
+  return p;
+#else
+  void* p = std::calloc(1, bytes);
+  if (!p) throw std::bad_alloc();
+  return p;
+#endif
+}
+
+inline void UnmapLocal(void* p, size_t bytes) {
+#if defined(__linux__)
+  munmap(p, (bytes + PAGE_BYTES - 1) & ~(PAGE_BYTES - 1));
+#else
+  (void)bytes;
+  std::free(p);
+#endif
+}
+
+// Backing actually obtained for an arena chunk (HugePage falls back to transparent huge pages, then to 4 KiB)
+enum class Pages : uint8_t { Small, Transparent, Huge };
+
+// Per-thread bump allocator over reserved pages. Fresh pages are zero (kernel), so rings never need a memset.
+// Chunks prefer the owner's NUMA node (SetNode), so rings stay local even if the owner later migrates
+class Arena {
+public:
+  explicit Arena(Parameter::Backing b = Parameter::Lazy, int n = -1) : backing(b), node(n) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() {
+    for (Chunk& c : chunks) Unmap(c.base, c.size);
+  }
+
+  void* Allocate(size_t bytes) {
+    bytes = (bytes + 63) & ~size_t(63);
+    for (size_t i = 0; i < free_list.size(); ++i) { // same-size reuse of released rings
+      if (free_list[i].second != bytes) continue;
+      void* p = free_list[i].first;
+      free_list[i] = free_list.back();
+      free_list.pop_back();
+      return p;
+    }
+    if (chunks.empty() || chunks.back().used + bytes > chunks.back().size) Grow(bytes);
+    Chunk& c = chunks.back();
+    void* p = c.base + c.used;
+    c.used += bytes;
+    return p;
+  }
+
+  // Small objects (std::map nodes): reused as is, never handed back to the kernel
+  void* AllocateNode(size_t bytes) {
+    bytes = (bytes + 63) & ~size_t(63);
+    for (size_t i = 0; i < node_free.size(); ++i) {
+      if (node_free[i].second != bytes) continue;
+      void* p = node_free[i].first;
+      node_free[i] = node_free.back();
+      node_free.pop_back();
+      return p;
+    }
+    return Allocate(bytes);
+  }
+
+  void FreeNode(void* p, size_t bytes) { node_free.emplace_back(p, (bytes + 63) & ~size_t(63)); }
+
+  // Owner thread: node for chunks mapped from now on
+  void SetNode(int n) { node = n; }
+  int Node() const { return node; }
+
+  // Readable from any thread (report)
+  size_t Mapped() const { return mapped.load(std::memory_order_relaxed); }
+  Pages PageKind() const { return pages.load(std::memory_order_relaxed); }
+
+  // Hands pages back to the kernel; reuse sees zero pages again
+  void Release(void* p, size_t bytes) {
+    bytes = (bytes + 63) & ~size_t(63);
+#if defined(__linux__)
+    madvise(p, bytes, MADV_DONTNEED);
+#else
+    std::memset(p, 0, bytes);
+#endif
+    free_list.emplace_back(p, bytes);
+  }
+
+  // Fault every page in (writable) from the calling thread, keeping existing contents
+  static void Touch(void* p, size_t bytes) {
+    volatile char* c = static_cast<volatile char*>(p);
+    for (size_t i = 0; i < bytes; i += PAGE_BYTES) c[i] = c[i];
+  }
+
+private:
+  struct Chunk { char* base; size_t size; size_t used; };
+  Parameter::Backing backing;
+  int node;
+  std::vector<Chunk> chunks;
+  std::vector<std::pair<void*, size_t>> free_list;
+  std::vector<std::pair<void*, size_t>> node_free;
+  std::atomic<size_t> mapped{0};
+  std::atomic<Pages> pages{Pages::Small};
+
+  void Grow(size_t bytes) {
+    const size_t size = std::max(ARENA_CHUNK_BYTES, (bytes + PAGE_BYTES - 1) & ~(PAGE_BYTES - 1));
+    chunks.push_back(Chunk{static_cast<char*>(Map(size)), size, 0});
+    mapped.fetch_add(size, std::memory_order_relaxed);
+  }
+
+  // Hugetlb pages are pre-faulted by the calling (owner) thread, so they are local by first touch.
+  // Other chunks are bound to the node before any page is faulted
+  void* Map(size_t size) {
+#if defined(__linux__)
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    if (backing == Parameter::HugePage) {
+      // Reserved (no MAP_NORESERVE): fails up front instead of SIGBUS on first write when the pool is short
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+      if (p != MAP_FAILED) {
+        pages.store(Pages::Huge, std::memory_order_relaxed);
+        return p;
+      }
+      // No reserved huge pages: 2 MiB aligned chunk with THP advice
+      char* raw = static_cast<char*>(mmap(nullptr, size + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, flags, -1, 0));
+      if (raw == MAP_FAILED) throw std::bad_alloc();
+      char* base = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + HUGE_PAGE_BYTES - 1) & ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+      if (base != raw) munmap(raw, (size_t)(base - raw));
+      if (base + size != raw + size + HUGE_PAGE_BYTES) munmap(base + size, (size_t)(raw + size + HUGE_PAGE_BYTES - (base + size)));
+      PreferNode(base, size, node);
+      if (madvise(base, size, MADV_HUGEPAGE) == 0 && pages.load(std::memory_order_relaxed) == Pages::Small) {
+        pages.store(Pages::Transparent, std::memory_order_relaxed);
+      }
+      return base;
+    }
+    const bool populate = (backing == Parameter::Populate);
+    const bool multi = NumaNodes() > 1 && node >= 0;
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | ((populate && !multi) ? MAP_POPULATE : 0), -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    if (multi) {
+      PreferNode(p, size, node);
+      if (populate) Touch(p, size); // MAP_POPULATE would fault before the policy is set
+    }
+    return p;
+#else
+    void* p = std::calloc(1, size);
+    if (!p) throw std::bad_alloc();
+    return p;
+#endif
+  }
+
+  static void Unmap(void* p, size_t size) {
+#if defined(__linux__)
+    munmap(p, size);
+#else
+    (void)size;
+    std::free(p);
+#endif
+  }
+};
+
+// Container allocator over an owner's Arena (owner thread only, like the arena)
+template <class T>
+struct ArenaAllocator {
+  using value_type = T;
+  Arena* arena;
+
+  explicit ArenaAllocator(Arena* a) : arena(a) {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena->AllocateNode(n * sizeof(T))); }
+  void deallocate(T* p, size_t n) { arena->FreeNode(p, n * sizeof(T)); }
+
+  template <class U> bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+  template <class U> bool operator!=(const ArenaAllocator<U>& o) const { return arena != o.arena; }
+};
+    }
+
+// Single producer (owning thread), any number of concurrent readers.
+// head is a monotonic sequence: slot = seq & mask. The writer publishes each sample with one store on head,
+// readers copy a window and re-read head to discard slots the writer may have lapped meanwhile (seqlock-style)
+struct alignas(64) RingBuffer {
+  static constexpr uint32_t ESCAPE = 0xFFFFFFFF; // compact slot whose value lives in the overflow ring
+  static constexpr size_t OVERFLOW_SLOTS = 16;
+  static constexpr Cycles SATURATED = ~Cycles(0); // Read: escaped sample whose overflow entry was reused (value lost)
+  static constexpr uint32_t CORE_UNKNOWN = 0xFFFFFFFF;
+  static constexpr uint32_t CORE_MIGRATED = 0x80000000; // flag on the stop core: Start ran on another core
+  static constexpr Cycles NO_TRIGGER = ~Cycles(0);
+
+  struct Overflow { std::atomic<uint64_t> tag; Cycles value; }; // tag = seq + 1 (0: empty)
+
+  // [begin, end) sequence range copied by Read
+  struct Window { uint64_t begin = 0; uint64_t end = 0; size_t size() const { return (size_t)(end - begin); } };
+
+  Cycles* data = nullptr;      // Wide: capacity slots in the owning thread's arena
+  uint32_t* compact = nullptr; // Compact: capacity slots, followed by the overflow ring
+  Overflow* overflow = nullptr;
+  Internal::HistogramCounters* hist = nullptr; // IdOptions::histogram
+  uint32_t* cores = nullptr;   // IdOptions::cores: TSC_AUX per slot (CORE_UNKNOWN for Fast stops)
+  uint64_t* pmu = nullptr;     // Latte::Pmu: PMU_COUNTERS x capacity counter deltas (SoA), attached on first Pmu::Start
+  uint64_t* stamps = nullptr;  // IdOptions::timestamps: TSC of the pulse that closed each slot's gap
+  std::atomic<uint64_t> head{0}; // samples ever pushed
+  uint64_t generation = 0;       // Registry::NextGeneration at Create (reader cursors restart when it changes)
+  size_t mask = BUFFER_MASK;
+  uint8_t overflow_head = 0;
+
+  // 0xFF: unset/unknown, 0xFE: mixed
+  std::atomic<uint8_t> calib_key{0xFF};
+
+  std::atomic<uint64_t> migrations{0}; // Mid/Hard samples whose Start and Stop ran on different cores (owner writes)
+
+  // 1-in-N sampling: period (any thread may change it) and the owner's countdown
+  std::atomic<uint32_t> sample_every{1};
+  uint32_t sample_left = 1;
+
+  // IdOptions::threshold: Stop deltas above it trigger a flight-recorder capture (max: off, so one compare)
+  std::atomic<Cycles> trigger{NO_TRIGGER};
+
+  // Owner only. True when this occurrence is not recorded
+  __attribute__((always_inline)) inline bool SkipSample() {
+    if (__builtin_expect(--sample_left != 0, 1)) return true;
+    sample_left = std::max<uint32_t>(1, sample_every.load(std::memory_order_relaxed));
+    return false;
+  }
+
+  __attribute__((always_inline)) inline void push(Cycles val, uint8_t key, uint32_t core = CORE_UNKNOWN) {
+    const uint8_t k = calib_key.load(std::memory_order_relaxed);
+    if (__builtin_expect(k != key && k != 0xFE, 0)) calib_key.store(k == 0xFF ? key : 0xFE, std::memory_order_relaxed);
+
+    if (__builtin_expect(hist != nullptr, 0)) hist->Record(val);
+
+    const uint64_t h = head.load(std::memory_order_relaxed); // owner is the only writer
+    if (__builtin_expect(cores != nullptr, 0)) cores[h & mask] = core;
+    if (__builtin_expect(compact != nullptr, 0)) PushCompact(h, val);
+    else data[h & mask] = val;
+    head.store(h + 1, std::memory_order_release); // plain store on x86
+  }
+
+  // Event TSC for the sample the next push publishes (owner only)
+  __attribute__((always_inline)) inline void StoreStamp(uint64_t tsc) { stamps[head.load(std::memory_order_relaxed) & mask] = tsc; }
+
+  // Counter deltas for the sample the next push publishes (owner only)
+  __attribute__((always_inline)) inline void StorePmu(const uint64_t* deltas) {
+    const size_t i = (size_t)(head.load(std::memory_order_relaxed) & mask);
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) pmu[k * capacity() + i] = deltas[k];
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  // Appends a consistent, push-ordered copy of samples [max(from, oldest retained), head) to out.
+  // Never blocks the writer; begin > from means samples were overwritten before they could be read.
+  // core_out (optional) receives the matching TSC_AUX values (CORE_UNKNOWN without IdOptions::cores),
+  // pmu_out (optional) PMU_COUNTERS deltas per sample (0 without Latte::Pmu), stamp_out (optional) event TSCs
+  // (0 without IdOptions::timestamps)
+  Window Read(std::vector<Cycles>& out, uint64_t from = 0, std::vector<uint32_t>* core_out = nullptr,
+              std::vector<uint64_t>* pmu_out = nullptr, std::vector<uint64_t>* stamp_out = nullptr) const {
+    const uint64_t cap = capacity();
+    const uint64_t h1 = head.load(std::memory_order_acquire);
+    Window w{std::max(from, h1 > cap ? h1 - cap : 0), h1};
+    if (w.begin >= w.end) return Window{h1, h1};
+
+    const size_t base = out.size();
+    out.resize(base + w.size());
+    Cycles* dst = out.data() + base;
+    if (compact) {
+      for (uint64_t q = w.begin; q < w.end; ++q) dst[q - w.begin] = Decode(q);
+    } else { // at most two contiguous runs
+      const size_t first = (size_t)(w.begin & mask);
+      const size_t run = std::min(w.size(), capacity() - first);
+      std::memcpy(dst, data + first, run * sizeof(Cycles));
+      std::memcpy(dst + run, data, (w.size() - run) * sizeof(Cycles));
+    }
+    const size_t core_base = core_out ? core_out->size() : 0;
+    if (core_out) {
+      core_out->resize(core_base + w.size(), CORE_UNKNOWN);
+      if (cores) {
+        const size_t first = (size_t)(w.begin & mask);
+        const size_t run = std::min(w.size(), capacity() - first);
+        std::memcpy(core_out->data() + core_base, cores + first, run * sizeof(uint32_t));
+        std::memcpy(core_out->data() + core_base + run, cores, (w.size() - run) * sizeof(uint32_t));
+      }
+    }
+    const size_t pmu_base = pmu_out ? pmu_out->size() : 0;
+    if (pmu_out) {
+      pmu_out->resize(pmu_base + w.size() * PMU_COUNTERS, 0);
+      if (pmu) {
+        uint64_t* dst_pmu = pmu_out->data() + pmu_base;
+        for (uint64_t q = w.begin; q < w.end; ++q) {
+          for (size_t k = 0; k < PMU_COUNTERS; ++k) *dst_pmu++ = pmu[k * cap + (q & mask)];
+        }
+      }
+    }
+    const size_t stamp_base = stamp_out ? stamp_out->size() : 0;
+    if (stamp_out) {
+      stamp_out->resize(stamp_base + w.size(), 0);
+      if (stamps) {
+        const size_t first = (size_t)(w.begin & mask);
+        const size_t run = std::min(w.size(), capacity() - first);
+        std::memcpy(stamp_out->data() + stamp_base, stamps + first, run * sizeof(uint64_t));
+        std::memcpy(stamp_out->data() + stamp_base + run, stamps, (w.size() - run) * sizeof(uint64_t));
+      }
+    }
+
+    // Writer at h2 may be overwriting seq (h2 - cap) right now: everything older is unreliable
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t h2 = head.load(std::memory_order_relaxed);
+    const uint64_t valid = (h2 + 1 > cap) ? h2 + 1 - cap : 0;
+    if (valid > w.begin) {
+      const uint64_t drop = std::min(valid, w.end) - w.begin;
+      out.erase(out.begin() + base, out.begin() + base + (size_t)drop);
+      if (core_out) core_out->erase(core_out->begin() + core_base, core_out->begin() + core_base + (size_t)drop);
+      if (pmu_out) pmu_out->erase(pmu_out->begin() + pmu_base, pmu_out->begin() + pmu_base + (size_t)drop * PMU_COUNTERS);
+      if (stamp_out) stamp_out->erase(stamp_out->begin() + stamp_base, stamp_out->begin() + stamp_base + (size_t)drop);
+      w.begin += drop;
+    }
+    return w;
+  }
+
+  void* storage() const { return compact ? static_cast<void*>(compact) : static_cast<void*>(data); }
+
+  static size_t Capacity(size_t requested) {
+    size_t c = 64;
+    while (c < requested && c < (size_t(1) << 30)) c <<= 1;
+    return c;
+  }
+
+  static size_t Bytes(size_t capacity, Encoding enc) {
+    return (enc == Encoding::Compact) ? capacity * sizeof(uint32_t) + OVERFLOW_SLOTS * sizeof(Overflow)
+                                      : capacity * sizeof(Cycles);
+  }
+
+  size_t bytes() const { return Bytes(capacity(), compact ? Encoding::Compact : Encoding::Wide); }
+
+private:
+  __attribute__((always_inline)) inline void PushCompact(uint64_t seq, Cycles val) {
+    if (__builtin_expect(val < ESCAPE, 1)) {
+      compact[seq & mask] = static_cast<uint32_t>(val);
+      return;
+    }
+    Overflow& o = overflow[overflow_head];
+    o.tag.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    o.value = val;
+    o.tag.store(seq + 1, std::memory_order_release);
+    compact[seq & mask] = ESCAPE;
+    overflow_head = static_cast<uint8_t>((overflow_head + 1) % OVERFLOW_SLOTS);
+  }
+
+  // Escaped samples whose overflow entry is gone (or being rewritten) read back as SATURATED, never as a made-up value
+  inline Cycles Decode(uint64_t seq) const {
+    const uint32_t v = compact[seq & mask];
+    if (__builtin_expect(v != ESCAPE, 1)) return v;
+    for (size_t k = 0; k < OVERFLOW_SLOTS; ++k) {
+      const Overflow& o = overflow[k];
+      if (o.tag.load(std::memory_order_acquire) != seq + 1) continue;
+      const Cycles value = o.value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (o.tag.load(std::memory_order_relaxed) == seq + 1) return value;
+    }
+    return SATURATED;
+  }
+};
+
+// Timestamped events (Latte::Event recorders): SoA ring of (start TSC, duration, registry index, depth, calib key).
+// Same single-writer protocol as RingBuffer: monotonic head, readers validate the copied window
+struct alignas(64) EventBuffer {
+  struct Window { uint64_t begin = 0; uint64_t end = 0; size_t size() const { return (size_t)(end - begin); } };
+
+  Cycles* starts = nullptr;
+  Cycles* durations = nullptr;
+  uint32_t* ids = nullptr; // Registry index (Slot::NO_SLOT: registry full)
+  uint8_t* depths = nullptr;
+  uint8_t* keys = nullptr;
+  std::atomic<uint64_t> head{0};
+  size_t mask = 0;
+
+  // Owner-only nesting stack, separate from ThreadStorage's so Fast/Mid/Hard keep their layout
+  Cycles stack_starts[MAX_ACTIVE_SLOTS];
+  uint32_t stack_ids[MAX_ACTIVE_SLOTS];
+  uint8_t stack_modes[MAX_ACTIVE_SLOTS];
+  size_t depth = 0;
+
+  // Local ID -> registry index cache for ad-hoc IDs (owner only)
+  std::map<ID, uint32_t> local;
+
+  static size_t Bytes(size_t capacity) { return capacity * (2 * sizeof(Cycles) + sizeof(uint32_t) + 2); }
+
+  void Bind(void* mem, size_t capacity) {
+    mask = capacity - 1;
+    char* p = static_cast<char*>(mem);
+    starts = reinterpret_cast<Cycles*>(p);     p += capacity * sizeof(Cycles);
+    durations = reinterpret_cast<Cycles*>(p);  p += capacity * sizeof(Cycles);
+    ids = reinterpret_cast<uint32_t*>(p);      p += capacity * sizeof(uint32_t);
+    depths = reinterpret_cast<uint8_t*>(p);    p += capacity;
+    keys = reinterpret_cast<uint8_t*>(p);
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  __attribute__((always_inline)) inline void push(Cycles start, Cycles duration, uint32_t id, uint8_t d, uint8_t key) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    const size_t i = (size_t)(h & mask);
+    starts[i] = start;
+    durations[i] = duration;
+    ids[i] = id;
+    depths[i] = d;
+    keys[i] = key;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  __attribute__((noinline)) uint32_t Intern(ID id) {
+    auto it = local.find(id);
+    if (it != local.end()) return it->second;
+    const uint32_t index = Internal::Registry::Get().Register(id).index;
+    local.emplace(id, index);
+    return index;
+  }
+
+  // Appends the retained, validated window to the SoA vectors
+  Window Read(std::vector<Cycles>& s, std::vector<Cycles>& d, std::vector<uint32_t>& id, std::vector<uint8_t>& dp, std::vector<uint8_t>& k) const {
+    const uint64_t cap = capacity();
+    const uint64_t h1 = head.load(std::memory_order_acquire);
+    Window w{h1 > cap ? h1 - cap : 0, h1};
+    const size_t base = s.size();
+    for (uint64_t q = w.begin; q < w.end; ++q) {
+      const size_t i = (size_t)(q & mask);
+      s.push_back(starts[i]);
+      d.push_back(durations[i]);
+      id.push_back(ids[i]);
+      dp.push_back(depths[i]);
+      k.push_back(keys[i]);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t h2 = head.load(std::memory_order_relaxed);
+    const uint64_t valid = (h2 + 1 > cap) ? h2 + 1 - cap : 0;
+    if (valid > w.begin) {
+      const size_t drop = (size_t)(std::min(valid, w.end) - w.begin);
+      s.erase(s.begin() + base, s.begin() + base + drop);
+      d.erase(d.begin() + base, d.begin() + base + drop);
+      id.erase(id.begin() + base, id.begin() + base + drop);
+      dp.erase(dp.begin() + base, dp.begin() + base + drop);
+      k.erase(k.begin() + base, k.begin() + base + drop);
+      w.begin += drop;
+    }
+    return w;
+  }
+};
+
+namespace Internal {
+// LATTE_CALL_TREE edge: one ring under one parent node. Written by the owner only (relaxed), nodes are never removed
+struct CallNode {
+  RingBuffer* rb = nullptr; // lookup key on the owning thread
+  ID id = nullptr;
+  uint32_t parent = 0;
+  uint32_t first_child = 0, next_sibling = 0;
+  std::atomic<uint64_t> count{0};
+  std::atomic<Cycles> inclusive{0}, self{0};
+};
+constexpr uint32_t CALL_NODE_FULL = (uint32_t)MAX_CALL_NODES - 1; // shared by every path past the table size
+
+// Per-thread perf_event group read with rdpmc (no syscall per sample). Counters that failed to open read as 0
+struct PmuCounters {
+  std::array<PmuEvent, PMU_COUNTERS> events{};
+  std::array<unsigned, PMU_COUNTERS> width_shift{}; // 64 - pmc_width: sign-extends the raw rdpmc value
+#if defined(__linux__)
+  std::array<int, PMU_COUNTERS> fds{-1, -1, -1, -1};
+  std::array<perf_event_mmap_page*, PMU_COUNTERS> pages{};
+#endif
+  bool ok = false; // at least one counter readable from user space
+
+  // Opens the counters for the calling thread
+  void Open(const std::array<PmuEvent, PMU_COUNTERS>& wanted) {
+    events = wanted;
+#if defined(__linux__) && !defined(_MSC_VER)
+    int leader = -1;
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+      if (events[k] == PmuEvent::None) continue;
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = Config(events[k]);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+      if (fd < 0 && leader >= 0) fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // group rejected: standalone
+      if (fd < 0) { events[k] = PmuEvent::None; continue; }
+      void* page = mmap(nullptr, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+      perf_event_mmap_page* pc = (page == MAP_FAILED) ? nullptr : static_cast<perf_event_mmap_page*>(page);
+      if (!pc || !pc->cap_user_rdpmc || pc->pmc_width == 0) { // rdpmc not allowed (sysfs rdpmc=0, no PMU in the VM)
+        if (pc) munmap(page, (size_t)sysconf(_SC_PAGESIZE));
+        ::close(fd);
+        events[k] = PmuEvent::None;
+        continue;
+      }
+      if (leader < 0) leader = fd;
+      fds[k] = fd;
+      pages[k] = pc;
+      width_shift[k] = (pc->pmc_width >= 64) ? 0u : 64u - (unsigned)pc->pmc_width;
+      ok = true;
+    }
+#else
+    events.fill(PmuEvent::None);
+#endif
+  }
+
+  void Close() {
+#if defined(__linux__)
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+      if (pages[k]) munmap(pages[k], (size_t)sysconf(_SC_PAGESIZE));
+      if (fds[k] >= 0) ::close(fds[k]);
+      pages[k] = nullptr;
+      fds[k] = -1;
+    }
+#endif
+    ok = false;
+  }
+
+  // Counter values by the perf_event_mmap_page protocol: pc->offset + sign-extended rdpmc, retried while the
+  // kernel rewrites the page (pc->lock changed). index[k]: hardware counter at the read, 0 when not scheduled
+  __attribute__((always_inline)) inline void Read(uint64_t* out, uint32_t* index) const {
+#if defined(__linux__) && !defined(_MSC_VER)
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+      const perf_event_mmap_page* pc = pages[k];
+      uint32_t seq = 0, idx = 0;
+      uint64_t count = 0;
+      if (pc) {
+        do {
+          seq = __atomic_load_n(&pc->lock, __ATOMIC_ACQUIRE);
+          idx = __atomic_load_n(&pc->index, __ATOMIC_RELAXED);
+          count = (uint64_t)__atomic_load_n(&pc->offset, __ATOMIC_RELAXED);
+          if (idx) count += (uint64_t)((int64_t)(__rdpmc((int)idx - 1) << width_shift[k]) >> width_shift[k]);
+          __atomic_thread_fence(__ATOMIC_ACQUIRE); // compiler barrier on x86: the reads stay inside the lock window
+        } while (__atomic_load_n(&pc->lock, __ATOMIC_RELAXED) != seq);
+      }
+      out[k] = count;
+      index[k] = idx;
+    }
+#else
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) out[k] = index[k] = 0;
+#endif
+  }
+
+  // True when every opened counter was scheduled at both reads on the same hardware counter
+  __attribute__((always_inline)) inline bool Steady(const uint32_t* start, const uint32_t* stop) const {
+#if defined(__linux__) && !defined(_MSC_VER)
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+      if (pages[k] && (start[k] == 0 || start[k] != stop[k])) return false;
+    }
+#else
+    (void)start;
+    (void)stop;
+#endif
+    return true;
+  }
+
+#if defined(__linux__)
+  static uint64_t Config(PmuEvent e) {
+    switch (e) {
+      case PmuEvent::CoreCycles:   return PERF_COUNT_HW_CPU_CYCLES;
+      case PmuEvent::Instructions: return PERF_COUNT_HW_INSTRUCTIONS;
+      case PmuEvent::CacheMisses:  return PERF_COUNT_HW_CACHE_MISSES;
+      case PmuEvent::BranchMisses: return PERF_COUNT_HW_BRANCH_MISSES;
+      default:                     return 0;
+    }
+  }
+#endif
+};
+    }
+
+struct ThreadStorage {
+  explicit ThreadStorage(Parameter::Backing backing = Parameter::Lazy) : home(Internal::CurrentCpuNode().node), arena(backing, home) {}
+  ~ThreadStorage() {
+    if (EventBuffer* e = events.load(std::memory_order_relaxed)) e->~EventBuffer(); // arena-placed
+    ClosePmu();
+  }
+
+  RingBuffer* stack_buffers[MAX_ACTIVE_SLOTS]; // resolved at Start, outside the measured window
+  Cycles stack_starts[MAX_ACTIVE_SLOTS];
+  uint8_t stack_modes[MAX_ACTIVE_SLOTS]; // Latte::Mode encoded
+  uint32_t stack_cores[MAX_ACTIVE_SLOTS]; // TSC_AUX at Start (Mid/Hard only)
+  size_t stack_ptr = 0;
+
+#if LATTE_CALL_TREE
+  // Node 0 is the root; readers scan [1, tree_size) and follow parent indices
+  Internal::CallNode tree[MAX_CALL_NODES];
+  std::atomic<uint32_t> tree_size{1};
+  uint32_t stack_nodes[MAX_ACTIVE_SLOTS];
+  Cycles stack_child[MAX_ACTIVE_SLOTS]; // inclusive time of the finished children of each open pair
+
+  // Start: node of rb under the enclosing pair
+  __attribute__((always_inline)) inline void TreeEnter(RingBuffer* rb) {
+    stack_nodes[stack_ptr] = Child(stack_ptr ? stack_nodes[stack_ptr - 1] : 0, rb);
+    stack_child[stack_ptr] = 0;
+  }
+
+  // Stop (stack_ptr already popped to the closed pair): totals, and the parent's children time
+  __attribute__((always_inline)) inline void TreeLeave(Cycles delta) {
+    Internal::CallNode& node = tree[stack_nodes[stack_ptr]];
+    const Cycles child = stack_child[stack_ptr];
+    node.count.store(node.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    node.inclusive.store(node.inclusive.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    node.self.store(node.self.load(std::memory_order_relaxed) + (delta > child ? delta - child : 0), std::memory_order_relaxed);
+    if (stack_ptr > 0) stack_child[stack_ptr - 1] += delta;
+  }
+
+  __attribute__((always_inline)) inline uint32_t Child(uint32_t parent, RingBuffer* rb) {
+    for (uint32_t i = tree[parent].first_child; i != 0; i = tree[i].next_sibling) {
+      if (tree[i].rb == rb) return i;
+    }
+    return AddChild(parent, rb);
+  }
+
+  __attribute__((noinline)) uint32_t AddChild(uint32_t parent, RingBuffer* rb) {
+    const uint32_t n = tree_size.load(std::memory_order_relaxed);
+    if (parent == Internal::CALL_NODE_FULL || n >= Internal::CALL_NODE_FULL) {
+      if (n < MAX_CALL_NODES) tree_size.store(MAX_CALL_NODES, std::memory_order_release); // publish the overflow node
+      return Internal::CALL_NODE_FULL;
+    }
+    Internal::CallNode& node = tree[n];
+    node.rb = rb;
+    for (auto& [id, buffer] : history) {
+      if (&buffer == rb) { node.id = id; break; }
+    }
+    node.parent = parent;
+    node.next_sibling = tree[parent].first_child;
+    tree[parent].first_child = n;
+    tree_size.store(n + 1, std::memory_order_release);
+    return n;
+  }
+#endif
+
+  // Placed on the creating thread's node (MapLocal): storage, stack tables and ring chunks share it
+  static void* operator new(size_t bytes) { return Internal::MapLocal(bytes); }
+  static void operator delete(void* p, size_t bytes) { Internal::UnmapLocal(p, bytes); }
+
+  int home = -1; // node of this storage and of its first ring chunks
+  int cpu = -1;  // owner's cpu / node at Manager::Identify
+  int node = -1;
+  Internal::Arena arena;
+
+  // Latte::Pmu: counters opened for the owning thread on first use, values and hardware indexes at each open Start
+  Internal::PmuCounters* pmu = nullptr;
+  uint64_t stack_pmu[MAX_ACTIVE_SLOTS][PMU_COUNTERS];
+  uint32_t stack_pmu_index[MAX_ACTIVE_SLOTS][PMU_COUNTERS];
+
+  __attribute__((always_inline)) inline Internal::PmuCounters* Pmu() {
+    if (__builtin_expect(pmu != nullptr, 1)) return pmu;
+    return OpenPmu();
+  }
+
+  __attribute__((cold)) Internal::PmuCounters* OpenPmu();
+
+  // Owner thread only (counters belong to the thread that opened them)
+  void ClosePmu() {
+    if (!pmu) return;
+    pmu->Close();
+    delete pmu;
+    pmu = nullptr;
+  }
+
+  // Delta storage next to the ring, published under mutex so readers see either nullptr or the full array
+  __attribute__((noinline)) void AttachPmu(RingBuffer* rb) {
+    uint64_t* mem = static_cast<uint64_t*>(arena.Allocate(rb->capacity() * PMU_COUNTERS * sizeof(uint64_t)));
+    std::lock_guard<std::mutex> lock(mutex);
+    rb->pmu = mem;
+  }
+
+  // Captured on the owning thread at Manager::Register
+  uint32_t tid = 0;
+  char name[16] = {};
+
+  // Flight-recorder triggers (IdOptions::threshold): the owner fills [flight_tail, flight_head) in Stop, the drain
+  // copies the rings (Manager::CaptureFlights) and advances flight_tail. Slots are read under mutex
+  struct FlightTrigger {
+    RingBuffer* ring = nullptr; // nullptr once the ID was dropped
+    uint64_t head = 0;          // ring head just after the triggering sample
+    uint32_t tid = 0;
+    Cycles delta = 0, threshold = 0, tsc = 0;
+  };
+  static constexpr size_t FLIGHT_SLOTS = 8;
+  FlightTrigger flight_slots[FLIGHT_SLOTS];
+  std::atomic<uint64_t> flight_head{0};
+  std::atomic<uint64_t> flight_tail{0};
+
+  // Held by the owner only while inserting/erasing history nodes, and by readers while iterating history
+  std::mutex mutex;
+
+  // Event recorder storage, created on first Latte::Event use (readers load it under mutex)
+  std::atomic<EventBuffer*> events{nullptr};
+
+  __attribute__((always_inline)) inline EventBuffer* Events() {
+    EventBuffer* e = events.load(std::memory_order_relaxed);
+    if (__builtin_expect(e != nullptr, 1)) return e;
+    return CreateEvents();
+  }
+
+  __attribute__((cold)) EventBuffer* CreateEvents();
+
+  // pointer comparison (owns every buffer, registered or ad-hoc). Nodes live in the arena, next to the rings
+  std::map<ID, RingBuffer, std::less<ID>, Internal::ArenaAllocator<std::pair<const ID, RingBuffer>>> history{Internal::ArenaAllocator<std::pair<const ID, RingBuffer>>(&arena)};
+  __attribute__((always_inline)) inline RingBuffer* GetOrAdd(ID id) {
+    auto it = history.find(id);
+    if (__builtin_expect(it != history.end(), 1)) return &it->second;
+    return Create(id);
+  }
+
+  __attribute__((noinline)) RingBuffer* Create(ID id) {
+    const IdOptions opts = Internal::Registry::Get().Options(id);
+    const size_t capacity = RingBuffer::Capacity(opts.capacity);
+    void* mem = arena.Allocate(RingBuffer::Bytes(capacity, opts.encoding));
+    Internal::HistogramCounters* hist = nullptr;
+    if (opts.histogram) hist = new (arena.Allocate(sizeof(Internal::HistogramCounters))) Internal::HistogramCounters();
+    uint32_t* cores = opts.cores ? static_cast<uint32_t*>(arena.Allocate(capacity * sizeof(uint32_t))) : nullptr;
+    uint64_t* stamps = opts.timestamps ? static_cast<uint64_t*>(arena.Allocate(capacity * sizeof(uint64_t))) : nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    RingBuffer& rb = history[id];
+    rb.generation = Internal::Registry::Get().NextGeneration();
+    rb.mask = capacity - 1;
+    rb.hist = hist;
+    rb.cores = cores;
+    rb.stamps = stamps;
+    rb.sample_every.store(std::max<uint32_t>(1, opts.sample_every), std::memory_order_relaxed);
+    rb.sample_left = std::max<uint32_t>(1, opts.sample_every);
+    rb.trigger.store(opts.threshold ? opts.threshold : RingBuffer::NO_TRIGGER, std::memory_order_relaxed);
+    if (opts.encoding == Encoding::Compact) {
+      rb.compact = static_cast<uint32_t*>(mem);
+      rb.overflow = reinterpret_cast<RingBuffer::Overflow*>(rb.compact + capacity);
+      for (size_t k = 0; k < RingBuffer::OVERFLOW_SLOTS; ++k) new (&rb.overflow[k]) RingBuffer::Overflow{};
+    } else {
+      rb.data = static_cast<Cycles*>(mem);
+    }
+    return &rb;
+  }
+
+  void Drop(ID id) {
+    auto it = history.find(id);
+    if (it == history.end()) return;
+    void* mem = it->second.storage();
+    const size_t bytes = it->second.bytes();
+    Internal::HistogramCounters* hist = it->second.hist;
+    uint32_t* cores = it->second.cores;
+    uint64_t* stamps = it->second.stamps;
+    uint64_t* pmu_deltas = it->second.pmu;
+    const size_t capacity = it->second.capacity();
+    [[maybe_unused]] const RingBuffer* dropped = &it->second;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      history.erase(it);
+      for (uint64_t i = flight_tail.load(std::memory_order_relaxed), n = flight_head.load(std::memory_order_relaxed); i < n; ++i) {
+        if (flight_slots[i % FLIGHT_SLOTS].ring == dropped) flight_slots[i % FLIGHT_SLOTS].ring = nullptr;
+      }
+    }
+#if LATTE_CALL_TREE
+    for (uint32_t i = 1, n = tree_size.load(std::memory_order_relaxed); i < n; ++i) {
+      if (tree[i].rb == dropped) tree[i].rb = nullptr; // a new ring may reuse the address
+    }
+#endif
+    arena.Release(mem, bytes);
+    if (hist) arena.Release(hist, sizeof(Internal::HistogramCounters));
+    if (cores) arena.Release(cores, capacity * sizeof(uint32_t));
+    if (stamps) arena.Release(stamps, capacity * sizeof(uint64_t));
+    if (pmu_deltas) arena.Release(pmu_deltas, capacity * PMU_COUNTERS * sizeof(uint64_t));
+  }
+
+  // Registered IDs: flat index into map nodes (std::map nodes never move)
+  RingBuffer* slots[MAX_REGISTERED_IDS] = {};
+  __attribute__((always_inline)) inline RingBuffer* Resolve(const Slot& slot) {
+    if (__builtin_expect(slot.index < MAX_REGISTERED_IDS && slots[slot.index] != nullptr, 1)) return slots[slot.index];
+    return Bind(slot);
+  }
+
+  __attribute__((noinline)) RingBuffer* Bind(const Slot& slot) {
+    RingBuffer* rb = GetOrAdd(slot.name);
+    if (slot.index < MAX_REGISTERED_IDS) slots[slot.index] = rb;
+    return rb;
+  }
+};
+
+namespace Internal {
+// Reader-side position in one ring, keyed by (thread, ID) rather than by ring address: a dropped ring's memory may be
+// reused by the next one (calibration Drop, recycled threads), so the cursor also holds the ring generation
+struct RingCursor { uint64_t generation = 0; uint64_t seq = 0; }; // seq: first sample not consumed yet
+using Cursors = std::map<std::pair<const ThreadStorage*, ID>, RingCursor>;
+
+// Where to resume reading rb (0 for a ring the cursors have not seen, or a newer ring under the same key)
+inline uint64_t CursorFrom(const Cursors& c, const ThreadStorage* ts, ID id, const RingBuffer& rb) {
+  auto it = c.find({ts, id});
+  return (it != c.end() && it->second.generation == rb.generation) ? it->second.seq : 0;
+}
+    }
+
+// One harvested run of consecutive samples from a (thread, id) ring
+struct DrainBatch {
+  const ThreadStorage* thread = nullptr;
+  ID id = nullptr;
+  uint8_t calib_key = 0xFF;
+  uint64_t first_seq = 0; // sequence number of samples[0] in its ring
+  const Cycles* samples = nullptr;
+  size_t count = 0;
+  uint64_t lost = 0; // overwritten before the drain reached them (drain fell behind)
+};
+using DrainSink = std::function<void(const DrainBatch&)>;
+
+// Flight-recorder capture: the recent samples of every ring on a thread, frozen when a Stop exceeded its ID's threshold
+struct FlightRecord {
+  const ThreadStorage* thread = nullptr;
+  uint32_t tid = 0;
+  ID trigger = nullptr;   // ID whose Stop exceeded its threshold
+  Cycles delta = 0;       // raw latency of that Stop
+  Cycles threshold = 0;
+  Cycles tsc = 0;         // TSC at capture
+  struct Ring {
+    ID id = nullptr;
+    uint8_t calib_key = 0xFF;
+    uint64_t first_seq = 0;
+    std::vector<Cycles> samples; // oldest first; the trigger's ring ends with the triggering sample
+  };
+  std::vector<Ring> rings;
+};
+using FlightSink = std::function<void(const FlightRecord&)>;
+
+// Manager::MeasureTscSkew result for one CPU, relative to the reference (first allowed) CPU
+struct CoreTsc {
+  uint32_t cpu = 0;
+  int64_t offset = 0;  // remote TSC - reference TSC, cycles
+  Cycles rtt = 0;      // best round trip: |error| <= rtt / 2
+  std::array<Cycles, MODE_COUNT> overhead{}; // back-to-back read cost on this core per Mode (Lean/Strict: their Start read)
+};
+
+class Manager {
+public:
+  std::mutex mutex;
+  std::vector<ThreadStorage*> thread_buffers;
+
+
+  double cycles_per_ns = 1.0; //Default: Unknown
+  Parameter::Backing backing = Parameter::Lazy; // applies to threads registered afterwards
+  size_t event_capacity = size_t(1) << 16;      // events per thread (rounded to a power of two), read on first Event use
+  // Latte::Pmu counters, read by each thread on its first Pmu::Start (None: unused slot)
+  std::array<PmuEvent, PMU_COUNTERS> pmu_events = {PmuEvent::CoreCycles, PmuEvent::Instructions, PmuEvent::CacheMisses, PmuEvent::BranchMisses};
+
+  static Manager& Get() { static Manager instance; return instance; }
+
+  // Calibration cache file ("" disables; LATTE_CALIB_CACHE env var used when empty). Keyed by CPU brand string
+  std::string calibration_cache;
+  const char* calibration_source = "none"; // cpuid.15 / hypervisor / sysfs / cpuid.16 / measured / cache
+  std::atomic<int> calibration_cpu{-1}; // where the offsets were measured (-1: unknown, e.g. loaded from the cache)
+
+  __attribute__((always_inline)) inline void EnsureCalibrated() {
+    std::call_once(calibrate_once, [&]() { Calibrate(); });
+  }
+
+  // Inter-core TSC offsets (ping-pong against the first allowed CPU) and per-core read overhead.
+  // Once measured, Mid/Hard samples that migrate between cores are corrected by the offset difference, and
+  // calibrated reports adjust each sample with a known stop core (IdOptions::cores) by that core's read cost
+  std::vector<CoreTsc> MeasureTscSkew(size_t rounds = 1000); //scroll down
+  std::vector<CoreTsc> tsc_cores; // last MeasureTscSkew result (guarded by mutex)
+  std::atomic<bool> skew_valid{false};
+
+  __attribute__((always_inline)) inline int64_t CoreTscOffset(uint32_t aux) const { return core_offsets[aux & 0xFFF].load(std::memory_order_relaxed); }
+
+  // Calibrates on a background thread; EnsureCalibrated (reports, traces) only blocks if it is still running
+  void CalibrateAsync() {
+    std::lock_guard<std::mutex> lock(calib_thread_mutex);
+    if (calib_thread.joinable()) return;
+    calib_thread = std::thread([this]() { EnsureCalibrated(); });
+  }
+
+  __attribute__((always_inline)) inline Cycles CalibrationOffset(uint8_t key) const {
+    if (key >= Internal::CALIB_KEY_COUNT) return 0;
+    if (!calib_valid[key]) return 0;
+    return calib_offsets[key];
+  }
+
+  // Called on the thread that owns ts
+  void Register(ThreadStorage* ts) {
+    Identify(ts);
+    std::lock_guard<std::mutex> lock(mutex);
+    thread_buffers.push_back(ts);
+  }
+
+  // Storage for the calling thread: a retired one from the pool (its samples stay in reports), else a new one.
+  // Pooled storages placed on the caller's node are preferred. Memory is bounded by the peak number of live recording threads
+  ThreadStorage* Attach() {
+    ThreadStorage* ts = nullptr;
+    {
+      const int node = Internal::CurrentCpuNode().node;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!idle.empty()) {
+        size_t pick = idle.size() - 1;
+        for (size_t i = idle.size(); i-- > 0;) {
+          if (idle[i]->home == node) { pick = i; break; }
+        }
+        ts = idle[pick];
+        idle.erase(idle.begin() + (std::ptrdiff_t)pick);
+      }
+    }
+    if (!ts) {
+      ts = new ThreadStorage(backing);
+      Register(ts);
+      return ts;
+    }
+    ts->stack_ptr = 0; // the previous owner may have exited inside a Start/Stop pair
+    if (EventBuffer* e = ts->events.load(std::memory_order_relaxed)) e->depth = 0;
+    Identify(ts);
+    return ts;
+  }
+
+  // Thread exit (see GetThreadStorage): ts stays in thread_buffers and waits for the next thread
+  void Retire(ThreadStorage* ts) {
+    ts->ClosePmu(); // counters follow the exiting thread, the next owner opens its own
+    std::lock_guard<std::mutex> lock(mutex);
+    idle.push_back(ts);
+  }
+
+  // Non-blocking Data Extraction (safe while threads are recording)
+  // Returns all retained samples for a specific ID (zero deltas included: validity comes from head, not the value)
+  std::vector<Cycles> ExtractRaw(ID id) {
+    std::vector<Cycles> output;
+    output.reserve(1024);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto* ts : thread_buffers) {
+      std::lock_guard<std::mutex> ts_lock(ts->mutex);
+      auto it = ts->history.find(id);
+      if (it == ts->history.end()) continue;
+      it->second.Read(output);
+    }
+    return output;
+  }
+
+  // Full-run histogram for id merged across threads (empty unless IdOptions::histogram was set)
+  Histogram MergedHistogram(ID id) {
+    Histogram out;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto* ts : thread_buffers) {
+      std::lock_guard<std::mutex> ts_lock(ts->mutex);
+      auto it = ts->history.find(id);
+      if (it != ts->history.end() && it->second.hist) out.Merge(*it->second.hist);
+    }
+    return out;
+  }
+
+  void Calibrate(); //scroll down
+
+  // Background collector: every period, harvests samples written since its last pass into sink.
+  // Producers are untouched (reads use RingBuffer::Read); sink runs on the drain thread
+  void StartDrain(DrainSink sink, std::chrono::milliseconds period = std::chrono::milliseconds(10)) {
+    StopDrain();
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex);
+      drain_sink = std::move(sink);
+      drain_running = true;
+    }
+    drain_thread = std::thread([this, period]() {
+      std::unique_lock<std::mutex> lock(drain_mutex);
+      while (drain_running) {
+        drain_cv.wait_for(lock, period, [this]() { return !drain_running; });
+        lock.unlock();
+        DrainOnce();
+        lock.lock();
+      }
+    });
+  }
+
+  // Stops the collector after one final pass
+  void StopDrain() {
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex);
+      if (!drain_running) return;
+      drain_running = false;
+    }
+    drain_cv.notify_all();
+    if (drain_thread.joinable()) drain_thread.join();
+  }
+
+  // One harvest pass (also callable without the background thread, e.g. from an existing event loop)
+  void DrainOnce() {
+    std::lock_guard<std::mutex> pass(drain_pass_mutex);
+
+    struct Pending { DrainBatch batch; size_t offset; };
+    std::vector<Pending> pending;
+    drain_scratch.clear();
+
+    Internal::Cursors cursors; // rebuilt each pass: forgets dropped buffers
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto* ts : thread_buffers) {
+        std::lock_guard<std::mutex> ts_lock(ts->mutex);
+        for (auto& [id, buffer] : ts->history) {
+          const uint64_t from = Internal::CursorFrom(drain_cursors, ts, id, buffer);
+          const size_t offset = drain_scratch.size();
+          const RingBuffer::Window w = buffer.Read(drain_scratch, from);
+          cursors[{ts, id}] = Internal::RingCursor{buffer.generation, w.end};
+          if (w.size() == 0 && w.begin <= from) continue;
+
+          DrainBatch b;
+          b.thread = ts;
+          b.id = id;
+          b.calib_key = buffer.calib_key.load(std::memory_order_relaxed);
+          b.first_seq = w.begin;
+          b.count = w.size();
+          b.lost = (w.begin > from) ? w.begin - from : 0;
+          pending.push_back(Pending{b, offset});
+        }
+      }
+    }
+    drain_cursors.swap(cursors);
+
+    DrainSink sink;
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex);
+      sink = drain_sink;
+    }
+    for (Pending& p : pending) {
+      p.batch.samples = drain_scratch.data() + p.offset;
+      drain_lost.fetch_add(p.batch.lost, std::memory_order_relaxed);
+      if (sink) sink(p.batch);
+    }
+
+    CaptureFlights();
+    FlightSink fsink;
+    std::deque<FlightRecord> flights;
+    {
+      std::lock_guard<std::mutex> lock(flight_mutex);
+      if (flight_sink) {
+        fsink = flight_sink;
+        flights.swap(flight_queue);
+      }
+    }
+    for (const FlightRecord& f : flights) fsink(f);
+  }
+
+  // Samples overwritten before the drain could read them, since startup
+  uint64_t DrainLost() const { return drain_lost.load(std::memory_order_relaxed); }
+
+  // Flight recorder (IdOptions::threshold): the triggering Stop only fills a per-thread slot; the drain thread
+  // (DrainOnce) copies the rings and hands the capture to the flight sink. Without a sink they wait for TakeFlightRecords
+  size_t flight_window = 256;      // latest samples copied per ring
+  size_t flight_queue_limit = 64;  // pending captures; triggers beyond it are counted in FlightDropped
+
+  void SetFlightSink(FlightSink sink) {
+    std::lock_guard<std::mutex> lock(flight_mutex);
+    flight_sink = std::move(sink);
+  }
+
+  std::vector<FlightRecord> TakeFlightRecords() {
+    CaptureFlights();
+    std::lock_guard<std::mutex> lock(flight_mutex);
+    std::vector<FlightRecord> out(std::make_move_iterator(flight_queue.begin()), std::make_move_iterator(flight_queue.end()));
+    flight_queue.clear();
+    return out;
+  }
+
+  // Pending triggers of every thread into FlightRecords. The copy runs here, off the recording thread, so it is never
+  // charged to the pairs still open around the triggering Stop. Rings other than the trigger's are read as of now
+  void CaptureFlights() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto* ts : thread_buffers) {
+      uint64_t tail = ts->flight_tail.load(std::memory_order_relaxed);
+      const uint64_t head = ts->flight_head.load(std::memory_order_acquire);
+      if (tail == head) continue;
+      std::lock_guard<std::mutex> ts_lock(ts->mutex);
+      for (; tail < head; ++tail) {
+        const ThreadStorage::FlightTrigger& t = ts->flight_slots[tail % ThreadStorage::FLIGHT_SLOTS];
+        if (t.ring == nullptr) continue;
+        FlightRecord f;
+        f.thread = ts;
+        f.tid = t.tid;
+        f.delta = t.delta;
+        f.threshold = t.threshold;
+        f.tsc = t.tsc;
+        f.rings.reserve(ts->history.size());
+        for (auto& [id, buffer] : ts->history) {
+          const bool trigger = (&buffer == t.ring);
+          if (trigger) f.trigger = id;
+          const uint64_t h = trigger ? t.head : buffer.head.load(std::memory_order_acquire);
+          if (h == 0) continue;
+          FlightRecord::Ring r;
+          r.id = id;
+          r.calib_key = buffer.calib_key.load(std::memory_order_relaxed);
+          const RingBuffer::Window w = buffer.Read(r.samples, h > flight_window ? h - flight_window : 0);
+          r.first_seq = w.begin;
+          if (w.end > h) r.samples.resize(r.samples.size() - std::min<size_t>(r.samples.size(), (size_t)(w.end - h))); // trigger's ring ends at it
+          f.rings.push_back(std::move(r));
+        }
+        QueueFlight(std::move(f));
+      }
+      ts->flight_tail.store(tail, std::memory_order_release);
+    }
+  }
+
+  void QueueFlight(FlightRecord&& record) {
+    std::lock_guard<std::mutex> lock(flight_mutex);
+    if (flight_queue.size() >= flight_queue_limit) {
+      flight_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    flight_queue.push_back(std::move(record));
+  }
+
+  uint64_t FlightDropped() const { return flight_dropped.load(std::memory_order_relaxed); }
+  void DropFlight() { flight_dropped.fetch_add(1, std::memory_order_relaxed); }
+
+  ~Manager() {
+    StopDrain();
+    {
+      std::lock_guard<std::mutex> lock(calib_thread_mutex);
+      if (calib_thread.joinable()) calib_thread.join();
+    }
+    // Retired storages have no owner left; storages of still-running threads are never freed
+    for (ThreadStorage* ts : idle) delete ts;
+  }
+
+private:
+  std::vector<ThreadStorage*> idle; // retired by exited threads, reused by Attach (guarded by mutex)
+
+  void Identify(ThreadStorage* ts) {
+    const Internal::CpuNode where = Internal::CurrentCpuNode();
+    ts->arena.SetNode(where.node); // owner thread: later chunks follow the new owner
+    std::lock_guard<std::mutex> lock(ts->mutex);
+    ts->cpu = where.cpu;
+    ts->node = where.node;
+#if defined(__linux__)
+    ts->tid = (uint32_t)syscall(SYS_gettid);
+    pthread_getname_np(pthread_self(), ts->name, sizeof(ts->name));
+#endif
+  }
+
+  std::mutex drain_mutex;      // sink + running flag
+  std::mutex drain_pass_mutex; // serializes passes (cursors + scratch)
+  std::condition_variable drain_cv;
+  std::thread drain_thread;
+  DrainSink drain_sink;
+  bool drain_running = false;
+  Internal::Cursors drain_cursors;
+  std::vector<Cycles> drain_scratch;
+  std::atomic<uint64_t> drain_lost{0};
+
+  std::mutex flight_mutex;
+  FlightSink flight_sink;
+  std::deque<FlightRecord> flight_queue;
+  std::atomic<uint64_t> flight_dropped{0};
+
+  std::array<std::atomic<int64_t>, 4096> core_offsets{}; // by TSC_AUX cpu number, valid once skew_valid (read lock-free by Stop)
+
+  std::once_flag calibrate_once;
+  std::array<Cycles, Internal::CALIB_KEY_COUNT> calib_offsets{};
+  std::array<bool, Internal::CALIB_KEY_COUNT> calib_valid{};
+  std::mutex calib_thread_mutex;
+  std::thread calib_thread;
+
+  std::string CachePath() const {
+    if (!calibration_cache.empty()) return calibration_cache;
+    const char* env = std::getenv("LATTE_CALIB_CACHE");
+    return env ? std::string(env) : std::string();
+  }
+
+  // text: "latte-calibration 1", brand, cycles_per_ns, CALIB_KEY_COUNT offsets
+  bool LoadCalibration() {
+    const std::string path = CachePath();
+    if (path.empty()) return false;
+    std::ifstream in(path);
+    std::string magic, brand;
+    int version = 0;
+    if (!(in >> magic >> version) || magic != "latte-calibration" || version != 1) return false;
+    in >> std::ws;
+    if (!std::getline(in, brand) || brand != Internal::CpuBrand()) return false;
+    double cpns = 0;
+    size_t count = 0;
+    if (!(in >> cpns >> count) || cpns <= 0 || count != Internal::CALIB_KEY_COUNT) return false;
+    std::array<Cycles, Internal::CALIB_KEY_COUNT> offsets{};
+    for (auto& o : offsets) if (!(in >> o)) return false;
+
+    cycles_per_ns = cpns;
+    calib_offsets = offsets;
+    calib_valid.fill(true);
+    calibration_source = "cache";
+    return true;
+  }
+
+  void SaveCalibration() const {
+    const std::string path = CachePath();
+    if (path.empty()) return;
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return;
+    out << "latte-calibration 1\n" << Internal::CpuBrand() << "\n"
+        << std::setprecision(17) << cycles_per_ns << " " << Internal::CALIB_KEY_COUNT << "\n";
+    for (Cycles o : calib_offsets) out << o << " ";
+    out << "\n";
+  }
+};
+
+namespace Internal {
+// Hands the thread's storage back to the Manager pool when the thread exits.
+// Recording from thread_local destructors that run after this one is unsupported
+struct ThreadExit {
+  ThreadStorage* ts = nullptr;
+  ~ThreadExit() { if (ts) Manager::Get().Retire(ts); }
+};
+
+// Cold path of GetThreadStorage: the guard has a destructor, so it stays out of the hot thread_local
+__attribute__((noinline)) inline ThreadStorage* AttachThread() {
+  static thread_local ThreadExit guard;
+  guard.ts = Manager::Get().Attach();
+  return guard.ts;
+}
+    }
+
+inline ThreadStorage* GetThreadStorage() {
+  static thread_local ThreadStorage* ts = nullptr;
+  if (__builtin_expect(!ts, 0)) ts = Internal::AttachThread();
+  return ts;
+}
+
+inline Internal::PmuCounters* ThreadStorage::OpenPmu() {
+  pmu = new Internal::PmuCounters();
+  pmu->Open(Manager::Get().pmu_events);
+  return pmu;
+}
+
+inline EventBuffer* ThreadStorage::CreateEvents() {
+  const size_t capacity = RingBuffer::Capacity(Manager::Get().event_capacity);
+  EventBuffer* e = new (arena.Allocate(sizeof(EventBuffer))) EventBuffer();
+  e->Bind(arena.Allocate(EventBuffer::Bytes(capacity)), capacity);
+  std::lock_guard<std::mutex> lock(mutex);
+  events.store(e, std::memory_order_release);
+  return e;
+}
+
+namespace Internal {
+inline RingBuffer* GetBuffer(ID id) { return GetThreadStorage()->GetOrAdd(id); }
+
+// 1-in-N LATTE_PULSE: only the event before a sampled one reads the TSC, so deltas stay between consecutive events.
+// last is nonzero only while it holds the previous event's TSC: 0 after a sampled push, so a switch back to every
+// event (SetSampling(id, 1)) drops its first gap instead of pushing one measured from a stale stamp
+__attribute__((noinline)) inline void SampledPulse(RingBuffer* rb, uint64_t& last) {
+  const uint32_t left = --rb->sample_left;
+  if (left == 1) {
+    last = Intrinsic::RDTSC();
+  } else if (left == 0) {
+    const uint64_t now = Intrinsic::RDTSC();
+    if (last != 0) {
+      if (rb->stamps) rb->StoreStamp(now);
+      rb->push(now - last, CALIB_KEY_PULSE);
+    }
+    last = 0;
+    rb->sample_left = std::max<uint32_t>(2, rb->sample_every.load(std::memory_order_relaxed));
+  }
+}
+
+inline RingBuffer* Warm(ThreadStorage* ts, ID id) { return ts->GetOrAdd(id); }
+inline RingBuffer* Warm(ThreadStorage* ts, const Slot& slot) { return ts->Resolve(slot); }
+
+__attribute__((always_inline)) inline void PushValue(RingBuffer* rb, uint64_t value) {
+  if (__builtin_expect(rb->sample_every.load(std::memory_order_relaxed) > 1, 0) && rb->SkipSample()) return;
+  rb->push(value, CALIB_KEY_VALUE);
+}
+    }
+
+// Records a raw integer (queue depth, batch size, levels touched...) on the calling thread's ring for id.
+// Never calibrated; reported unit-less in the VALUES section. Keep value IDs apart from timing IDs
+template <int L = 1> inline void Record(ID id, uint64_t value) {
+  if constexpr (L <= LATTE_LEVEL) Internal::PushValue(GetThreadStorage()->GetOrAdd(id), value);
+}
+template <int L = 1> inline void Record(const Slot& slot, uint64_t value) {
+  if constexpr (L <= LATTE_LEVEL) Internal::PushValue(GetThreadStorage()->Resolve(slot), value);
+}
+
+// 1-in-N sampling for id: applied to every thread's existing buffer and to buffers created later (N <= 1: record all)
+inline void SetSampling(ID id, uint32_t every) {
+  IdOptions opts = Internal::Registry::Get().Options(id);
+  opts.sample_every = every;
+  Configure(id, opts);
+
+  Manager& mgr = Manager::Get();
+  std::lock_guard<std::mutex> lock(mgr.mutex);
+  for (auto* ts : mgr.thread_buffers) {
+    std::lock_guard<std::mutex> ts_lock(ts->mutex);
+    auto it = ts->history.find(id);
+    if (it != ts->history.end()) it->second.sample_every.store(std::max<uint32_t>(1, every), std::memory_order_relaxed);
+  }
+}
+
+// Flight-recorder threshold on the raw Stop delta (cycles, 0: off), for existing and future buffers of id
+inline void SetThreshold(ID id, Cycles threshold) {
+  IdOptions opts = Internal::Registry::Get().Options(id);
+  opts.threshold = threshold;
+  Configure(id, opts);
+
+  Manager& mgr = Manager::Get();
+  std::lock_guard<std::mutex> lock(mgr.mutex);
+  for (auto* ts : mgr.thread_buffers) {
+    std::lock_guard<std::mutex> ts_lock(ts->mutex);
+    auto it = ts->history.find(id);
+    if (it != ts->history.end()) it->second.trigger.store(threshold ? threshold : RingBuffer::NO_TRIGGER, std::memory_order_relaxed);
+  }
+}
+
+// Same, in nanoseconds (converted with the calibrated TSC rate)
+inline void SetThreshold(ID id, std::chrono::nanoseconds threshold) {
+  Manager& mgr = Manager::Get();
+  mgr.EnsureCalibrated();
+  SetThreshold(id, (Cycles)std::llround((double)threshold.count() * mgr.cycles_per_ns));
+}
+
+namespace Internal {
+// A Stop above its ID's threshold: a few stores into the thread's trigger slots, released to the drain thread.
+// Nothing is copied or locked here, so the enclosing open pairs are not inflated (and cannot trigger in cascade)
+__attribute__((noinline, cold)) inline void Triggered(RingBuffer* rb, Cycles delta) {
+  ThreadStorage* ts = GetThreadStorage();
+  const uint64_t h = ts->flight_head.load(std::memory_order_relaxed);
+  if (h - ts->flight_tail.load(std::memory_order_acquire) >= ThreadStorage::FLIGHT_SLOTS) {
+    Manager::Get().DropFlight();
+    return;
+  }
+  ThreadStorage::FlightTrigger& t = ts->flight_slots[h % ThreadStorage::FLIGHT_SLOTS];
+  t.ring = rb;
+  t.head = rb->head.load(std::memory_order_relaxed);
+  t.tid = ts->tid;
+  t.delta = delta;
+  t.threshold = rb->trigger.load(std::memory_order_relaxed);
+  t.tsc = Intrinsic::RDTSC();
+  ts->flight_head.store(h + 1, std::memory_order_release);
+}
+    }
+
+// Creates the calling thread's buffers for ids (ID or Slot) and faults their pages in.
+// No ids: faults in every buffer the thread already owns. Call from each recording thread before the hot phase
+template <typename... Ids>
+inline void Prewarm(const Ids&... ids) {
+  ThreadStorage* ts = GetThreadStorage();
+  if constexpr (sizeof...(ids) == 0) {
+    for (auto& [id, rb] : ts->history) {
+      Internal::Arena::Touch(rb.storage(), rb.bytes());
+      if (rb.cores) Internal::Arena::Touch(rb.cores, rb.capacity() * sizeof(uint32_t));
+    }
+  } else {
+    auto touch = [](RingBuffer* rb) {
+      Internal::Arena::Touch(rb->storage(), rb->bytes());
+      if (rb->cores) Internal::Arena::Touch(rb->cores, rb->capacity() * sizeof(uint32_t));
+    };
+    (touch(Internal::Warm(ts, ids)), ...);
+  }
+}
+
+namespace Internal {
+// Stop read for modes without TSC_AUX: leaves aux untouched (RingBuffer::CORE_UNKNOWN)
+template <Cycles (*TimeFunc)()>
+__attribute__((always_inline)) static inline Cycles NoAux(unsigned int&) { return TimeFunc(); }
+    }
+
+namespace Internal {
+// Mid/Hard pair whose Start and Stop ran on different cores: counted, flagged in the core ring, skew-corrected
+__attribute__((noinline, cold)) inline Cycles Migrated(RingBuffer* rb, Cycles delta, uint32_t start_core, unsigned int& stop_core) {
+  rb->migrations.store(rb->migrations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  const Manager& mgr = Manager::Get();
+  if (mgr.skew_valid.load(std::memory_order_acquire)) {
+    const int64_t corrected = (int64_t)delta - (mgr.CoreTscOffset(stop_core) - mgr.CoreTscOffset(start_core));
+    delta = (corrected > 0) ? (Cycles)corrected : 0;
+  }
+  stop_core |= RingBuffer::CORE_MIGRATED;
+  return delta;
+}
+    }
+
+// AuxFunc: same read as TimeFunc but also returning TSC_AUX (start/stop core for Mid/Hard, IdOptions::cores).
+// StopFunc: Stop read when it differs from the Start one (Lean/Strict: Start TimeFunc, Stop rdtscp;lfence)
+template <Mode M, Cycles (*TimeFunc)(), Cycles (*AuxFunc)(unsigned int&) = Internal::NoAux<TimeFunc>,
+          Cycles (*StopFunc)(unsigned int&) = AuxFunc>
+struct Recorder {
+  __attribute__((always_inline)) static inline void Start(ID id) {
+    ThreadStorage* ts = GetThreadStorage();
+    if (__builtin_expect(ts->stack_ptr < MAX_ACTIVE_SLOTS, 1)) Push(ts, ts->GetOrAdd(id));
+  }
+
+  __attribute__((always_inline)) static inline void Start(const Slot& slot) {
+    ThreadStorage* ts = GetThreadStorage();
+    if (__builtin_expect(ts->stack_ptr < MAX_ACTIVE_SLOTS, 1)) Push(ts, ts->Resolve(slot));
+  }
+
+  // A pair sampled out at Start is popped before the clock read: only recorded pairs pay for the TSC
+  __attribute__((always_inline)) static inline Cycles Stop(ID /*id*/) {
+    ThreadStorage* ts = GetThreadStorage();
+
+    if (__builtin_expect(ts->stack_ptr > 0, 1)) {
+      RingBuffer* rb = ts->stack_buffers[--ts->stack_ptr];
+      if (__builtin_expect(rb == nullptr, 0)) return 0; // sampled out at Start
+      unsigned int aux = RingBuffer::CORE_UNKNOWN;
+      const Cycles end = StopFunc(aux);
+      Cycles delta = end - ts->stack_starts[ts->stack_ptr]; // raw latency
+      const uint8_t start_mode = ts->stack_modes[ts->stack_ptr];
+      const uint8_t stop_mode  = static_cast<uint8_t>(M);
+      const uint8_t key = Internal::CalibKey(start_mode, stop_mode);
+      if constexpr (M != Mode::Fast) {
+        const uint32_t start_core = ts->stack_cores[ts->stack_ptr];
+        if (__builtin_expect(((Internal::CORE_AT_START >> start_mode) & 1) && start_core != aux, 0)) delta = Internal::Migrated(rb, delta, start_core, aux);
+      }
+      rb->push(delta, key, aux);
+      if (__builtin_expect(delta > rb->trigger.load(std::memory_order_relaxed), 0)) Internal::Triggered(rb, delta);
+#if LATTE_CALL_TREE
+      ts->TreeLeave(delta);
+#endif
+      return delta;
+    }
+    return 0;
+  }
+
+private:
+  // Buffer lookup happens before the timestamp so it never lands inside the measured window.
+  // Sampled-out occurrences push a null buffer and skip the TSC read
+  __attribute__((always_inline)) static inline void Push(ThreadStorage* ts, RingBuffer* rb) {
+#if LATTE_CALL_TREE
+    ts->TreeEnter(rb);
+#endif
+    if (__builtin_expect(rb->sample_every.load(std::memory_order_relaxed) > 1, 0) && rb->SkipSample()) {
+      ts->stack_buffers[ts->stack_ptr++] = nullptr;
+      return;
+    }
+    ts->stack_buffers[ts->stack_ptr] = rb;
+    ts->stack_modes[ts->stack_ptr] = static_cast<uint8_t>(M);
+    if constexpr (Internal::CoreAtStart(M)) {
+      unsigned int aux;
+      ts->stack_starts[ts->stack_ptr] = AuxFunc(aux);
+      ts->stack_cores[ts->stack_ptr] = aux;
+    } else {
+      ts->stack_starts[ts->stack_ptr] = TimeFunc();
+    }
+    ts->stack_ptr++;
+  }
+};
+// L: probe level. Probes with L > LATTE_LEVEL compile to nothing; Start and Stop of a pair must use the same L
+namespace Fast {
+using R = Recorder<Mode::Fast, Intrinsic::RDTSC>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) R::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Stop(s.name); }
+    }
+namespace Mid {
+using R = Recorder<Mode::Mid, Intrinsic::RDTSCP, Intrinsic::RDTSCP_AUX>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) R::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Stop(s.name); }
+    }
+namespace Hard {
+using R = Recorder<Mode::Hard, Intrinsic::RDTSCP_LFENCE, Intrinsic::RDTSCP_LFENCE_AUX>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) R::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Stop(s.name); }
+    }
+// Lean / Strict: no TSC_AUX at Start (rdtsc), so no migration check; Stop still keeps its core
+namespace Lean {
+using R = Recorder<Mode::Lean, Intrinsic::LFENCE_RDTSC, Internal::NoAux<Intrinsic::LFENCE_RDTSC>, Intrinsic::RDTSCP_AUX_LFENCE>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) R::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Stop(s.name); }
+    }
+namespace Strict {
+using R = Recorder<Mode::Strict, Intrinsic::LFENCE_RDTSC_LFENCE, Internal::NoAux<Intrinsic::LFENCE_RDTSC_LFENCE>, Intrinsic::RDTSCP_AUX_LFENCE>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) R::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Stop(s.name); }
+    }
+
+namespace Internal {
+// Recorder of each Mode (calibration walks every Start x Stop permutation)
+template <Mode M> struct ModeRecorder;
+template <> struct ModeRecorder<Mode::Fast> { using R = Fast::R; };
+template <> struct ModeRecorder<Mode::Mid> { using R = Mid::R; };
+template <> struct ModeRecorder<Mode::Hard> { using R = Hard::R; };
+template <> struct ModeRecorder<Mode::Lean> { using R = Lean::R; };
+template <> struct ModeRecorder<Mode::Strict> { using R = Strict::R; };
+    }
+
+// Hardware counters around a pair (Manager::pmu_events). Start reads the counters then the TSC, Stop the TSC then
+// the counters: the TSC window is a Hard x Hard pair, the counter deltas also cover both TSC reads.
+// Without a usable PMU (perf_event_open or rdpmc denied) pairs still record their TSC delta
+struct PmuRecorder {
+  __attribute__((always_inline)) static inline void Start(ID id) {
+    ThreadStorage* ts = GetThreadStorage();
+    if (__builtin_expect(ts->stack_ptr < MAX_ACTIVE_SLOTS, 1)) Push(ts, ts->GetOrAdd(id));
+  }
+
+  __attribute__((always_inline)) static inline void Start(const Slot& slot) {
+    ThreadStorage* ts = GetThreadStorage();
+    if (__builtin_expect(ts->stack_ptr < MAX_ACTIVE_SLOTS, 1)) Push(ts, ts->Resolve(slot));
+  }
+
+  __attribute__((always_inline)) static inline Cycles Stop(ID /*id*/) {
+    ThreadStorage* ts = GetThreadStorage();
+
+    if (__builtin_expect(ts->stack_ptr > 0, 1)) {
+      RingBuffer* rb = ts->stack_buffers[--ts->stack_ptr];
+      if (__builtin_expect(rb == nullptr, 0)) return 0; // sampled out at Start: no TSC or counter read
+      unsigned int aux;
+      const Cycles end = Intrinsic::RDTSCP_LFENCE_AUX(aux);
+      uint64_t now[PMU_COUNTERS];
+      uint32_t index[PMU_COUNTERS];
+      const Internal::PmuCounters* pc = ts->pmu;
+      if (pc && pc->ok) pc->Read(now, index);
+      Cycles delta = end - ts->stack_starts[ts->stack_ptr];
+      const uint32_t start_core = ts->stack_cores[ts->stack_ptr];
+      if (__builtin_expect(start_core != aux, 0)) delta = Internal::Migrated(rb, delta, start_core, aux);
+      if (pc && pc->ok && rb->pmu) {
+        // Multiplexed out or moved to another counter during the pair: no consistent delta, drop the sample
+        if (__builtin_expect(!pc->Steady(ts->stack_pmu_index[ts->stack_ptr], index), 0)) return 0;
+        uint64_t d[PMU_COUNTERS];
+        for (size_t k = 0; k < PMU_COUNTERS; ++k) d[k] = now[k] - ts->stack_pmu[ts->stack_ptr][k];
+        rb->StorePmu(d);
+      }
+      rb->push(delta, Internal::CalibKey((uint8_t)Mode::Hard, (uint8_t)Mode::Hard), aux);
+      if (__builtin_expect(delta > rb->trigger.load(std::memory_order_relaxed), 0)) Internal::Triggered(rb, delta);
+#if LATTE_CALL_TREE
+      ts->TreeLeave(delta);
+#endif
+      return delta;
+    }
+    return 0;
+  }
+
+private:
+  __attribute__((always_inline)) static inline void Push(ThreadStorage* ts, RingBuffer* rb) {
+#if LATTE_CALL_TREE
+    ts->TreeEnter(rb);
+#endif
+    if (__builtin_expect(rb->sample_every.load(std::memory_order_relaxed) > 1, 0) && rb->SkipSample()) {
+      ts->stack_buffers[ts->stack_ptr++] = nullptr;
+      return;
+    }
+    Internal::PmuCounters* pc = ts->Pmu();
+    if (pc->ok) {
+      if (__builtin_expect(rb->pmu == nullptr, 0)) ts->AttachPmu(rb);
+      pc->Read(ts->stack_pmu[ts->stack_ptr], ts->stack_pmu_index[ts->stack_ptr]);
+    }
+    ts->stack_buffers[ts->stack_ptr] = rb;
+    ts->stack_modes[ts->stack_ptr] = static_cast<uint8_t>(Mode::Hard);
+    unsigned int aux;
+    ts->stack_starts[ts->stack_ptr] = Intrinsic::RDTSCP_LFENCE_AUX(aux);
+    ts->stack_cores[ts->stack_ptr] = aux;
+    ts->stack_ptr++;
+  }
+};
+// Pmu::Start must be closed by Pmu::Stop (the counter snapshot lives in the pair's stack entry)
+namespace Pmu {
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) PmuRecorder::Start(id); }
+template <int L = 1> inline void Stop(ID id) { if constexpr (L <= LATTE_LEVEL) PmuRecorder::Stop(id); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) PmuRecorder::Start(s); }
+template <int L = 1> inline void Stop(const Slot& s) { if constexpr (L <= LATTE_LEVEL) PmuRecorder::Stop(s.name); }
+// True when at least one configured counter can be read on the calling thread (opens them on first call)
+inline bool Available() { return GetThreadStorage()->Pmu()->ok; }
+    }
+
+namespace Internal {
+// Start/stop reads per mode, with TSC_AUX where the instruction provides it (Fast leaves aux untouched)
+template <Mode M> struct Clock;
+template <> struct Clock<Mode::Fast> {
+  __attribute__((always_inline)) static inline Cycles Start(unsigned int&) { return Intrinsic::RDTSC(); }
+  __attribute__((always_inline)) static inline Cycles Stop(unsigned int&) { return Intrinsic::RDTSC(); }
+};
+template <> struct Clock<Mode::Mid> {
+  __attribute__((always_inline)) static inline Cycles Start(unsigned int& aux) { return Intrinsic::RDTSCP_AUX(aux); }
+  __attribute__((always_inline)) static inline Cycles Stop(unsigned int& aux) { return Intrinsic::RDTSCP_AUX(aux); }
+};
+template <> struct Clock<Mode::Hard> {
+  __attribute__((always_inline)) static inline Cycles Start(unsigned int& aux) { return Intrinsic::RDTSCP_LFENCE_AUX(aux); }
+  __attribute__((always_inline)) static inline Cycles Stop(unsigned int& aux) { return Intrinsic::RDTSCP_LFENCE_AUX(aux); }
+};
+template <> struct Clock<Mode::Lean> {
+  __attribute__((always_inline)) static inline Cycles Start(unsigned int&) { return Intrinsic::LFENCE_RDTSC(); }
+  __attribute__((always_inline)) static inline Cycles Stop(unsigned int& aux) { return Intrinsic::RDTSCP_AUX_LFENCE(aux); }
+};
+template <> struct Clock<Mode::Strict> {
+  __attribute__((always_inline)) static inline Cycles Start(unsigned int&) { return Intrinsic::LFENCE_RDTSC_LFENCE(); }
+  __attribute__((always_inline)) static inline Cycles Stop(unsigned int& aux) { return Intrinsic::RDTSCP_AUX_LFENCE(aux); }
+};
+    }
+
+// RAII probe: records on destruction (early return, exception). Start time lives in the object, not in
+// ThreadStorage's stack, so scopes may nest freely with Start/Stop pairs. Same calibration key as M x M
+template <Mode M, int L = 1>
+class Scope {
+public:
+  // bind() -> RingBuffer*, only called when the level is enabled (see LATTE_SCOPE)
+  template <typename F, typename = decltype(std::declval<F>()())>
+  __attribute__((always_inline)) explicit Scope(F&& bind) {
+    if constexpr (L <= LATTE_LEVEL) Begin(bind());
+  }
+  __attribute__((always_inline)) explicit Scope(ID id) {
+    if constexpr (L <= LATTE_LEVEL) Begin(GetThreadStorage()->GetOrAdd(id));
+  }
+  __attribute__((always_inline)) explicit Scope(const Slot& slot) {
+    if constexpr (L <= LATTE_LEVEL) Begin(GetThreadStorage()->Resolve(slot));
+  }
+
+  __attribute__((always_inline)) ~Scope() {
+    if constexpr (L <= LATTE_LEVEL) {
+      if (__builtin_expect(rb != nullptr, 1)) { // sampled out: no clock read
+        unsigned int aux = RingBuffer::CORE_UNKNOWN;
+        const Cycles end = Internal::Clock<M>::Stop(aux);
+        Cycles delta = end - start;
+        if constexpr (Internal::CoreAtStart(M)) {
+          if (__builtin_expect(start_core != aux, 0)) delta = Internal::Migrated(rb, delta, start_core, aux);
+        }
+        rb->push(delta, Internal::CalibKey((uint8_t)M, (uint8_t)M), aux);
+        if (__builtin_expect(delta > rb->trigger.load(std::memory_order_relaxed), 0)) Internal::Triggered(rb, delta);
+      }
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  __attribute__((always_inline)) inline void Begin(RingBuffer* b) {
+    if (__builtin_expect(b->sample_every.load(std::memory_order_relaxed) > 1, 0) && b->SkipSample()) return;
+    rb = b;
+    start = Internal::Clock<M>::Start(start_core);
+  }
+
+  RingBuffer* rb = nullptr; // null: disabled or sampled out
+  Cycles start = 0;
+  unsigned int start_core = RingBuffer::CORE_UNKNOWN;
+};
+
+// Cross-thread spans (queue handoff): Mark() on the producer, Complete(id, token) on the consumer.
+// The sample lands in the completing thread's ring; calibration key is (mark mode x complete mode)
+struct Token {
+  Cycles tsc = 0; // 0: not marked (disabled level)
+  uint32_t core = RingBuffer::CORE_UNKNOWN;
+  uint8_t mode = (uint8_t)Mode::Fast;
+};
+
+template <Mode M = Mode::Fast, int L = 1>
+__attribute__((always_inline)) inline Token Mark() {
+  Token t;
+  if constexpr (L <= LATTE_LEVEL) {
+    t.tsc = Internal::Clock<M>::Start(t.core);
+    t.mode = (uint8_t)M;
+  }
+  return t;
+}
+
+namespace Internal {
+// Handoffs cross cores by design: corrected with the measured skew (when known), not counted as migrations
+__attribute__((noinline)) inline Cycles CompleteSpan(RingBuffer* rb, Cycles end, unsigned int core, const Token& t, uint8_t mode) {
+  if (__builtin_expect(rb->sample_every.load(std::memory_order_relaxed) > 1, 0) && rb->SkipSample()) return 0;
+  int64_t delta = (int64_t)(end - t.tsc);
+  const Manager& mgr = Manager::Get();
+  if (t.core != core && t.core != RingBuffer::CORE_UNKNOWN && core != RingBuffer::CORE_UNKNOWN && mgr.skew_valid.load(std::memory_order_acquire)) {
+    delta -= mgr.CoreTscOffset(core) - mgr.CoreTscOffset(t.core);
+  }
+  const Cycles d = (delta > 0) ? (Cycles)delta : 0; // unmeasured skew can make a short handoff negative
+  rb->push(d, CalibKey(t.mode, mode), core);
+  return d;
+}
+    }
+
+template <Mode M = Mode::Fast, int L = 1>
+__attribute__((always_inline)) inline Cycles Complete(ID id, const Token& t) {
+  if constexpr (L <= LATTE_LEVEL) {
+    unsigned int core = RingBuffer::CORE_UNKNOWN;
+    const Cycles end = Internal::Clock<M>::Stop(core);
+    if (__builtin_expect(t.tsc == 0, 0)) return 0;
+    return Internal::CompleteSpan(GetThreadStorage()->GetOrAdd(id), end, core, t, (uint8_t)M);
+  }
+  return 0;
+}
+
+template <Mode M = Mode::Fast, int L = 1>
+__attribute__((always_inline)) inline Cycles Complete(const Slot& slot, const Token& t) {
+  if constexpr (L <= LATTE_LEVEL) {
+    unsigned int core = RingBuffer::CORE_UNKNOWN;
+    const Cycles end = Internal::Clock<M>::Stop(core);
+    if (__builtin_expect(t.tsc == 0, 0)) return 0;
+    return Internal::CompleteSpan(GetThreadStorage()->Resolve(slot), end, core, t, (uint8_t)M);
+  }
+  return 0;
+}
+
+// Event recorders: like Fast/Mid/Hard but every sample keeps its start TSC and nesting depth (timeline reconstruction).
+// Separate type and stack, so the delta-only recorders keep their overhead
+template <Mode M, Cycles (*TimeFunc)(), Cycles (*StopFunc)() = TimeFunc>
+struct EventRecorder {
+  __attribute__((always_inline)) static inline void Start(ID id) {
+    EventBuffer* e = GetThreadStorage()->Events();
+    if (__builtin_expect(e->depth < MAX_ACTIVE_SLOTS, 1)) {
+      auto it = e->local.find(id);
+      Push(e, (__builtin_expect(it != e->local.end(), 1)) ? it->second : e->Intern(id));
+    }
+  }
+
+  __attribute__((always_inline)) static inline void Start(const Slot& slot) {
+    EventBuffer* e = GetThreadStorage()->Events();
+    if (__builtin_expect(e->depth < MAX_ACTIVE_SLOTS, 1)) Push(e, slot.index);
+  }
+
+  __attribute__((always_inline)) static inline Cycles Stop() {
+    Cycles end = StopFunc();
+    EventBuffer* e = GetThreadStorage()->Events();
+    if (__builtin_expect(e->depth > 0, 1)) {
+      e->depth--;
+      const Cycles start = e->stack_starts[e->depth];
+      const uint8_t key = Internal::CalibKey(e->stack_modes[e->depth], static_cast<uint8_t>(M));
+      e->push(start, end - start, e->stack_ids[e->depth], static_cast<uint8_t>(e->depth), key);
+      return end - start;
+    }
+    return 0;
+  }
+
+private:
+  __attribute__((always_inline)) static inline void Push(EventBuffer* e, uint32_t index) {
+    e->stack_ids[e->depth] = index;
+    e->stack_modes[e->depth] = static_cast<uint8_t>(M);
+    e->stack_starts[e->depth] = TimeFunc();
+    e->depth++;
+  }
+};
+namespace Event {
+namespace Fast {
+using R = EventRecorder<Mode::Fast, Intrinsic::RDTSC>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot&) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+    }
+namespace Mid {
+using R = EventRecorder<Mode::Mid, Intrinsic::RDTSCP>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot&) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+    }
+namespace Hard {
+using R = EventRecorder<Mode::Hard, Intrinsic::RDTSCP_LFENCE>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot&) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+    }
+namespace Lean {
+using R = EventRecorder<Mode::Lean, Intrinsic::LFENCE_RDTSC, Intrinsic::RDTSCP_THEN_LFENCE>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot&) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+    }
+namespace Strict {
+using R = EventRecorder<Mode::Strict, Intrinsic::LFENCE_RDTSC_LFENCE, Intrinsic::RDTSCP_THEN_LFENCE>;
+template <int L = 1> inline void Start(ID id) { if constexpr (L <= LATTE_LEVEL) R::Start(id); }
+template <int L = 1> inline void Stop(ID) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+template <int L = 1> inline void Start(const Slot& s) { if constexpr (L <= LATTE_LEVEL) R::Start(s); }
+template <int L = 1> inline void Stop(const Slot&) { if constexpr (L <= LATTE_LEVEL) R::Stop(); }
+    }
+    }
+
+namespace Internal {
+// One fenced Start x Stop pair per permutation, all permutations interleaved in each calibration iteration
+template <Mode S, Mode E>
+inline void CalibratePair() {
+  LFENCE();
+  ModeRecorder<S>::R::Start(CALIB_PAIR[(size_t)S][(size_t)E]);
+  ModeRecorder<E>::R::Stop(CALIB_PAIR[(size_t)S][(size_t)E]);
+  LFENCE();
+}
+
+// Fast/Mid/Hard-only pairs (Legacy) or pairs with a Lean/Strict side
+constexpr bool LegacyPair(size_t i) { return i / MODE_COUNT < 3 && i % MODE_COUNT < 3; }
+
+template <bool Legacy, size_t... I>
+inline void CalibratePairs(std::index_sequence<I...>) {
+  ((LegacyPair(I) == Legacy ? CalibratePair<(Mode)(I / MODE_COUNT), (Mode)(I % MODE_COUNT)>() : void()), ...);
+}
+    }
+
+inline void Manager::Calibrate() {
+  if (LoadCalibration()) return;
+
+  { // TIME CALIBRATION (cycles_per_ns): platform-reported TSC rate, else a short measurement
+    const char* source = "measured";
+    const double hz = Internal::TscHzFromPlatform(&source);
+    if (hz > 0.0) {
+      cycles_per_ns = hz / 1e9;
+    } else {
+      auto t1 = std::chrono::steady_clock::now();
+      Cycles c1 = Intrinsic::RDTSC();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      Cycles c2 = Intrinsic::RDTSC();
+      auto t2 = std::chrono::steady_clock::now();
+      double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+      cycles_per_ns = (ns > 0.0) ? (double)(c2 - c1) / ns : 1.0;
+    }
+    calibration_source = source;
+  }
+
+  // PERMUTATION OVERHEAD
+  calibration_cpu.store(Internal::CurrentCpuNode().cpu, std::memory_order_relaxed);
+  constexpr int WARMUP_ITERS = 10000; // naturally overwrite by circular buffer
+  const int iters = (int)MAX_SAMPLES + WARMUP_ITERS;
+  // Lean/Strict pairs: 8 BUMED buckets give a stable median; 8K rings keep the last ones, warmup overwritten
+  constexpr size_t EXTRA_SAMPLES = 8 * 1024;
+  constexpr int EXTRA_ITERS = (int)EXTRA_SAMPLES + 2000;
+  for (size_t p = 0; p < MODE_COUNT * MODE_COUNT; ++p) {
+    if (!Internal::LegacyPair(p)) Configure(Internal::CALIB_PAIR[p / MODE_COUNT][p % MODE_COUNT], IdOptions{EXTRA_SAMPLES});
+  }
+
+  (void)GetThreadStorage(); // Force TLS init before sampling
+
+  constexpr auto PAIRS = std::make_index_sequence<MODE_COUNT * MODE_COUNT>{};
+  for (volatile int i = 0; i < iters; ++i) Internal::CalibratePairs<true>(PAIRS);
+  for (volatile int i = 0; i < EXTRA_ITERS; ++i) Internal::CalibratePairs<false>(PAIRS);
+
+  // PULSE OVERHEAD
+  for (volatile int i = 0; i < iters; ++i) {
+    Internal::LFENCE();
+    Latte::Fast::Start(Internal::CALIB_PULSE);
+    LATTE_PULSE("xxxx");
+    Latte::Mid::Stop(Internal::CALIB_PULSE);
+    Internal::LFENCE();
+  }
+
+  auto BUMED = [&](ID id) -> Cycles { // Median(Min(Bucket[1'000] ))
+    std::vector<Cycles> raw = ExtractRaw(id);
+    if (raw.empty()) return 0;
+
+    constexpr size_t BUCKET = 1000;
+    const size_t full = (raw.size() / BUCKET) * BUCKET;
+    if (full == 0) {
+      return *std::min_element(raw.begin(), raw.end());
+    }
+
+    std::vector<Cycles> mins;
+    mins.reserve(full / BUCKET);
+
+    for (size_t i = 0; i < full; i += BUCKET) {
+      Cycles m = std::numeric_limits<Cycles>::max();
+      for (size_t j = i; j < i + BUCKET; ++j) {
+        const Cycles v = raw[j];
+        if (v < m) m = v;
+      }
+      if (m != std::numeric_limits<Cycles>::max())
+        mins.push_back(m);
+    }
+
+    if (mins.empty()) {
+      return *std::min_element(raw.begin(), raw.end());
+    }
+
+    std::sort(mins.begin(), mins.end());
+    const size_t n = mins.size();
+    if (n & 1) return mins[n / 2];
+
+    const unsigned __int128 a = mins[n / 2 - 1];
+    const unsigned __int128 b = mins[n / 2];
+    return (Cycles)((a + b + 1) / 2);
+  };
+
+
+  for (uint8_t sm = 0; sm < MODE_COUNT; ++sm) {
+    for (uint8_t em = 0; em < MODE_COUNT; ++em) calib_offsets[Internal::CalibKey(sm, em)] = BUMED(Internal::CALIB_PAIR[sm][em]);
+  }
+  calib_offsets[Internal::CALIB_KEY_PULSE] = BUMED(Internal::CALIB_PULSE);
+
+  for (size_t i = 0; i < Internal::CALIB_KEY_COUNT; ++i) {
+    calib_valid[i] = true;
   }
 
   // Remove calibration telemetry
   if (ThreadStorage* ts = GetThreadStorage()) {
-    ts->history.erase(Internal::CALIB_FxF);
-    ts->history.erase(Internal::CALIB_FxM);
-    ts->history.erase(Internal::CALIB_FxH);
-    ts->history.erase(Internal::CALIB_MxF);
-    ts->history.erase(Internal::CALIB_MxM);
-    ts->history.erase(Internal::CALIB_MxH);
-    ts->history.erase(Internal::CALIB_HxF);
-    ts->history.erase(Internal::CALIB_HxM);
-    ts->history.erase(Internal::CALIB_HxH);
-    ts->history.erase(Internal::CALIB_PULSE);
-    ts->history.erase("xxxx");
+    for (size_t sm = 0; sm < MODE_COUNT; ++sm) {
+      for (size_t em = 0; em < MODE_COUNT; ++em) ts->Drop(Internal::CALIB_PAIR[sm][em]);
+    }
+    ts->Drop(Internal::CALIB_PULSE);
+    ts->Drop("xxxx");
+  }
+
+  SaveCalibration();
+}
+
+inline std::vector<CoreTsc> Manager::MeasureTscSkew(size_t rounds) {
+  std::vector<CoreTsc> out;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return out;
+  std::vector<uint32_t> cpus;
+  for (uint32_t c = 0; c < CPU_SETSIZE && c < core_offsets.size(); ++c) if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+  if (cpus.empty()) return out;
+
+  auto pin = [](uint32_t cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  };
+
+  // Median of bucket minima of back-to-back reads (same estimator as calibration, no rings)
+  auto read_cost = [](auto read) -> Cycles {
+    constexpr size_t BUCKETS = 16, PER = 256;
+    std::array<Cycles, BUCKETS> mins;
+    for (auto& m : mins) {
+      m = std::numeric_limits<Cycles>::max();
+      for (size_t i = 0; i < PER; ++i) {
+        const Cycles a = read();
+        const Cycles b = read();
+        m = std::min(m, b - a);
+      }
+    }
+    std::nth_element(mins.begin(), mins.begin() + BUCKETS / 2, mins.end());
+    return mins[BUCKETS / 2];
+  };
+
+  struct alignas(64) Line { std::atomic<uint64_t> seq{0}; Cycles tsc = 0; };
+  for (uint32_t cpu : cpus) {
+    Line ping, pong; // one cache line each way per round
+    CoreTsc r;
+    r.cpu = cpu;
+    r.rtt = std::numeric_limits<Cycles>::max();
+    std::atomic<bool> ok{true};
+
+    std::thread remote([&]() {
+      if (!pin(cpu)) { ok = false; pong.seq.store(~0ull, std::memory_order_release); return; }
+      r.overhead[0] = read_cost([] { return Intrinsic::RDTSC(); });
+      r.overhead[1] = read_cost([] { return Intrinsic::RDTSCP(); });
+      r.overhead[2] = read_cost([] { return Intrinsic::RDTSCP_LFENCE(); });
+      r.overhead[3] = read_cost([] { return Intrinsic::LFENCE_RDTSC(); });
+      r.overhead[4] = read_cost([] { return Intrinsic::LFENCE_RDTSC_LFENCE(); });
+      if (cpu == cpus[0]) return; // reference: offset 0 by definition
+      for (uint64_t k = 1; k <= rounds; ++k) {
+        while (ping.seq.load(std::memory_order_acquire) < k) _mm_pause();
+        pong.tsc = Intrinsic::RDTSCP();
+        pong.seq.store(k, std::memory_order_release);
+      }
+    });
+    if (cpu == cpus[0]) {
+      remote.join();
+      r.rtt = 0;
+      if (ok) out.push_back(r);
+      continue;
+    }
+    std::thread reference([&]() {
+      if (!pin(cpus[0])) { ok = false; ping.seq.store(~0ull, std::memory_order_release); return; }
+      for (uint64_t k = 1; k <= rounds; ++k) {
+        const Cycles a = Intrinsic::RDTSCP();
+        ping.seq.store(k, std::memory_order_release);
+        uint64_t seen;
+        while ((seen = pong.seq.load(std::memory_order_acquire)) < k) _mm_pause();
+        const Cycles c = Intrinsic::RDTSCP();
+        if (seen != k) break; // remote could not be pinned
+        if (c - a < r.rtt) {
+          r.rtt = c - a;
+          r.offset = (int64_t)(pong.tsc - a) - (int64_t)((c - a) / 2);
+        }
+      }
+    });
+    remote.join();
+    reference.join();
+    if (ok && r.rtt != std::numeric_limits<Cycles>::max()) out.push_back(r);
+  }
+
+  // Each entry goes from its old offset straight to the new one: Stop never sees a transient 0
+  std::vector<int64_t> offsets(core_offsets.size(), 0);
+  for (const CoreTsc& c : out) offsets[c.cpu] = c.offset;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (size_t i = 0; i < offsets.size(); ++i) core_offsets[i].store(offsets[i], std::memory_order_relaxed);
+  tsc_cores = out;
+  skew_valid.store(!out.empty(), std::memory_order_release);
+#else
+  (void)rounds;
+#endif
+  return out;
+}
+
+inline std::vector<Cycles> Snapshot(ID id) {
+  return Manager::Get().ExtractRaw(id);
+}
+
+namespace Internal {
+// Short report cell formatted on the stack with std::to_chars (no stream, no allocation); cut at CAP
+struct Text {
+  static constexpr size_t CAP = 64;
+  char s[CAP];
+  size_t n = 0;
+
+  Text() = default;
+  explicit Text(std::string_view v) { Put(v); }
+  operator std::string_view() const { return std::string_view(s, n); }
+
+  Text& Put(std::string_view v) {
+    const size_t k = std::min(v.size(), CAP - n);
+    std::memcpy(s + n, v.data(), k);
+    n += k;
+    return *this;
+  }
+  Text& Put(char c) {
+    if (n < CAP) s[n++] = c;
+    return *this;
+  }
+  Text& Fixed(double v, int prec) { return Chars(std::to_chars(s + n, s + CAP, v, std::chars_format::fixed, prec)); }
+  Text& General(double v, int prec) { return Chars(std::to_chars(s + n, s + CAP, v, std::chars_format::general, prec)); }
+  template <typename I>
+  Text& Int(I v) { return Chars(std::to_chars(s + n, s + CAP, v)); }
+
+private:
+  Text& Chars(std::to_chars_result r) {
+    if (r.ec == std::errc()) n = (size_t)(r.ptr - s);
+    else Put('#');
+    return *this;
+  }
+};
+
+inline Text TimeText(double ns) {
+  Text t;
+  if (ns < 1000.0)  t.Fixed(ns, 2).Put(" ns");
+  else if (ns < 1e6) t.Fixed(ns / 1e3, 2).Put(" us");
+  else if (ns < 1e9) t.Fixed(ns / 1e6, 2).Put(" ms");
+  else if (ns < 60e9) t.Fixed(ns / 1e9, 2).Put(" s");
+  else t.Fixed(ns / 60e9, 2).Put(" min");
+  return t;
+}
+
+// Counts with K/M/B/T suffixes above 1000
+inline Text LargeText(double val) {
+  const char* units[] = {"", "K", "M", "B", "T"};
+  int unit_idx = 0;
+  while (val >= 1000.0 && unit_idx < 4) { val /= 1000.0; unit_idx++; }
+  Text t;
+  if (unit_idx == 0) return t.Fixed(val, 0);
+  return t.Fixed(val, 2).Put(' ').Put(units[unit_idx]);
+}
+    }
+
+inline std::string FormatTime(double ns) {
+  return std::string(Internal::TimeText(ns));
+}
+
+inline Internal::CleanResult DataClean(const std::vector<double>& values) {
+  return Internal::CleanData(values);
+}
+
+// DumpToStream layout and statistics
+struct ReportOptions {
+  Parameter::Unit unit = Parameter::Cycle;
+  Parameter::Data data = Parameter::Raw;
+  std::vector<double> percentiles = {99.0, 99.9}; // one column each, after MEDIAN
+  unsigned threads = 0; // statistics workers (0: hardware concurrency, 1: serial)
+  Parameter::Breakdown breakdown = Parameter::Merged;
+  size_t burst_events = 16;        // PULSE section: a burst is this many consecutive pulses (0: off)...
+  double burst_window_ns = 10000;  // ...within this window (also the PEAK window)
+  Parameter::Layout layout = Parameter::Table;
+};
+
+namespace Internal {
+struct Series {
+  std::vector<Cycles> values;
+  std::vector<int32_t> core_adjust; // per-core calibration per sample (empty, or values.size(): see CoreCalibration)
+  uint8_t calib_key = CALIB_KEY_UNSET;
+
+  void MergeKey(uint8_t key) {
+    if (calib_key == CALIB_KEY_UNSET) calib_key = key;
+    else if (calib_key != key)        calib_key = CALIB_KEY_MIXED;
+  }
+};
+
+// Runs f(i) for i in [0, n) on up to `threads` workers (calling thread included); f must be independent per i
+template <typename F>
+inline void ParallelFor(size_t n, unsigned threads, F&& f) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = (unsigned)std::min<size_t>(threads, n);
+  if (threads <= 1) {
+    for (size_t i = 0; i < n; ++i) f(i);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < n; i = next.fetch_add(1, std::memory_order_relaxed)) f(i);
+  };
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+  work();
+  for (auto& t : pool) t.join();
+}
+
+struct Stats {
+  size_t n = 0;
+  size_t bypass = 0;
+  size_t saturated = 0; // RingBuffer::SATURATED samples (lost Compact escapes), excluded from everything else
+  double avg = 0, median = 0, std_dev = 0, skew = 0, min = 0, max = 0;
+  std::vector<double> percentiles; // same order as the requested percentiles
+};
+
+// ComputeStats working set, one per thread: capacity only grows, so a report allocates per worker, not per row
+struct StatsScratch {
+  std::vector<Cycles> adjusted, values, maxes, picked;
+  std::vector<size_t> ranks;
+};
+
+inline StatsScratch& ThreadStatsScratch() {
+  thread_local StatsScratch scratch;
+  return scratch;
+}
+
+// Calibrate, clean and summarize one series on raw Cycles (SIMD kernels). Median/percentiles by selection, no full sort
+// clean = false keeps every sample (value probes: spikes are the signal). st is overwritten; its percentiles keep their capacity
+inline void ComputeStats(const Series& series, Cycles off, const std::vector<double>& percentiles, bool clean, Stats& st) {
+  const Simd::Kernels& K = Simd::Get();
+  StatsScratch& sc = ThreadStatsScratch();
+  st.n = st.bypass = st.saturated = 0;
+  st.avg = st.median = st.std_dev = st.skew = st.min = st.max = 0;
+  st.percentiles.clear();
+  st.percentiles.reserve(percentiles.size());
+
+  std::vector<Cycles>& adjusted = sc.adjusted; // noise removal
+  adjusted.assign(series.values.begin(), series.values.end());
+  // Calibrated (off != 0) samples with a known stop core: off plus that core's adjustment, never below 0
+  const bool per_core = off && series.core_adjust.size() == adjusted.size();
+  if (per_core) {
+    for (size_t i = 0; i < adjusted.size(); ++i) {
+      if (adjusted[i] == RingBuffer::SATURATED) continue;
+      const Cycles o = (Cycles)std::max<int64_t>(0, (int64_t)off + series.core_adjust[i]);
+      adjusted[i] = (adjusted[i] > o) ? adjusted[i] - o : 0;
+    }
+  }
+  const auto lost = std::remove(adjusted.begin(), adjusted.end(), RingBuffer::SATURATED);
+  st.saturated = (size_t)(adjusted.end() - lost);
+  adjusted.erase(lost, adjusted.end());
+  if (off && !per_core) K.sub_clamp(adjusted.data(), adjusted.size(), off);
+
+  std::vector<Cycles>& values = clean ? sc.values : adjusted;
+  if (clean) st.bypass = CleanCycles(adjusted, values, nullptr, &sc.maxes);
+  st.n = values.size();
+  if (st.n == 0) return;
+  const size_t n = st.n;
+
+  // One fused pass: moments around a shift close to the data, then central moments
+  const double shift = (double)values[0];
+  const Simd::Moments mo = K.moments(values.data(), n, shift);
+  const double inv = 1.0 / (double)n;
+  const double m1 = mo.s1 * inv, m2 = mo.s2 * inv, m3 = mo.s3 * inv;
+  const double var = std::max(0.0, m2 - m1 * m1);
+  st.avg = shift + m1;
+  st.std_dev = std::sqrt(var);
+  const double c3 = m3 - 3.0 * m1 * m2 + 2.0 * m1 * m1 * m1;
+  st.skew = (n > 1 && st.std_dev > 1e-9) ? c3 / (st.std_dev * st.std_dev * st.std_dev) : 0.0;
+  st.min = (double)mo.min;
+  st.max = (double)mo.max;
+
+  // median needs n/2 (and n/2 - 1 when even); percentiles use nearest rank
+  std::vector<size_t>& ranks = sc.ranks;
+  ranks.clear();
+  ranks.push_back(n / 2);
+  if (n % 2 == 0) ranks.push_back(n / 2 - 1);
+  for (double p : percentiles) ranks.push_back(PercentileRank(p, n));
+  std::sort(ranks.begin(), ranks.end());
+  ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+  std::vector<Cycles>& picked = sc.picked;
+  SelectRanks(values, ranks, picked);
+  auto at = [&](size_t r) { return (double)picked[std::lower_bound(ranks.begin(), ranks.end(), r) - ranks.begin()]; };
+
+  st.median = (n % 2 == 0) ? (at(n / 2 - 1) + at(n / 2)) / 2.0 : at(n / 2);
+  for (double p : percentiles) st.percentiles.push_back(at(PercentileRank(p, n)));
+}
+
+inline Stats ComputeStats(const Series& series, Cycles off, const std::vector<double>& percentiles, bool clean = true) {
+  Stats st;
+  ComputeStats(series, off, percentiles, clean, st);
+  return st;
+}
+
+// One call path (LATTE_CALL_TREE): raw cycle totals, self = inclusive minus finished children
+struct CallRow {
+  ID id = nullptr;
+  uint32_t depth = 0;
+  uint64_t count = 0;
+  Cycles inclusive = 0, self = 0;
+  uint8_t calib_key = CALIB_KEY_UNSET;
+};
+
+// Latte::Pmu rings: counter delta sums over the retained samples
+struct PmuTotals {
+  uint64_t n = 0;
+  std::array<double, PMU_COUNTERS> sum{};
+};
+
+// Where a thread's storage sits relative to its owner (live reports only)
+struct Placement {
+  int cpu = -1, node = -1; // owner at attach
+  int home = -1;           // storage and first ring chunks
+  Pages pages = Pages::Small;
+  size_t mapped = 0;       // arena bytes reserved
+};
+
+// One LATTE_PULSE ring inside its merged series: series[id].values[begin, begin + count), push order
+struct PulseRun {
+  static constexpr size_t NO_STAMPS = ~size_t(0);
+  size_t begin = 0, count = 0;
+  size_t stamps = NO_STAMPS; // first of count event TSCs in ReportData::pulse_stamps (IdOptions::timestamps)
+};
+
+// Everything a report needs: collected live from the Manager or reloaded from a trace file
+struct ReportData {
+  std::map<ID, Series> series;
+  std::map<ID, Histogram> histograms; // IDs with IdOptions::histogram, merged across threads
+  std::map<ID, std::map<uint32_t, Series>> parts; // ReportOptions::breakdown: thread index or TSC_AUX -> samples
+  std::map<uint32_t, Text> part_labels; // inline text: no string per label
+  std::map<ID, uint64_t> migrations; // Mid/Hard samples with Start and Stop on different cores
+  std::vector<CallRow> call_tree;    // LATTE_CALL_TREE, merged across threads, depth-first
+  std::map<ID, PmuTotals> pmu;
+  std::array<PmuEvent, PMU_COUNTERS> pmu_events{};
+  std::vector<CoreTsc> tsc_cores;    // Manager::MeasureTscSkew, if it ran
+  std::vector<Placement> placement;  // per thread storage
+  std::map<ID, std::vector<PulseRun>> pulses;
+  std::vector<uint64_t> pulse_stamps; // every run's event TSCs, back to back
+  uint64_t now_tsc = 0;              // collection time (live), for the age of pulse gaps
+  int invariant_tsc = -1;            // CPUID flag, -1: unknown (trace files)
+  double cycles_per_ns = 1.0;
+  std::array<Cycles, CALIB_KEY_COUNT> calib_offsets{};
+  double interval_ns = 0; // Latte::Interval window length (0: whole run)
+
+  Cycles CalibrationOffset(uint8_t key) const { return (key < CALIB_KEY_COUNT) ? calib_offsets[key] : 0; }
+  const uint64_t* Stamps(const PulseRun& r) const { return (r.stamps == PulseRun::NO_STAMPS) ? nullptr : pulse_stamps.data() + r.stamps; }
+
+  // Empties every entry but keeps map nodes and vector capacity, so refilling with the same IDs allocates nothing.
+  // Entries left empty are skipped by the report (series, parts) or pruned by CollectLive (side sections)
+  void Clear() {
+    for (auto& [id, s] : series) { s.values.clear(); s.core_adjust.clear(); s.calib_key = CALIB_KEY_UNSET; }
+    for (auto& [id, h] : histograms) h.Clear();
+    for (auto& [id, by] : parts)
+      for (auto& [key, p] : by) { p.values.clear(); p.core_adjust.clear(); p.calib_key = CALIB_KEY_UNSET; }
+    for (auto& [id, m] : migrations) m = 0;
+    call_tree.clear();
+    for (auto& [id, p] : pmu) p = PmuTotals{};
+    tsc_cores.clear();
+    placement.clear();
+    for (auto& [id, runs] : pulses) runs.clear();
+    pulse_stamps.clear();
+    now_tsc = 0;
+    invariant_tsc = -1;
+    cycles_per_ns = 1.0;
+    calib_offsets.fill(0);
+    interval_ns = 0;
+  }
+};
+
+// Inter-arrival analysis of LATTE_PULSE rings (cycles). Each ring is scanned in push order, then merged per ID
+struct PulseStats {
+  uint64_t gaps = 0;
+  double gap_sum = 0;
+  double jitter_sum = 0; // |gap[i] - gap[i-1]| (RFC 3550 style interarrival jitter, unsmoothed)
+  uint64_t jitter_n = 0;
+  Cycles max_gap = 0;
+  int64_t max_gap_age = -1; // now - end of the longest gap (timestamps only)
+  int64_t last_age = -1;    // now - newest pulse (timestamps only): a stalled feed shows here
+  uint64_t bursts = 0;      // runs where burst_events consecutive pulses fit in the window
+  size_t peak = 0;          // most pulses inside one window
+
+  // gaps[i]: time from pulse i to pulse i + 1 (pulse 0 precedes the first retained gap); stamps[i]: TSC of pulse i + 1
+  // Gaps are used raw: an inter-arrival time is not a measured region, so the probe overhead is not taken out of it
+  // t: scratch for the pulse times (capacity reused across calls)
+  void Scan(const Cycles* v, size_t n, const uint64_t* stamps, uint64_t now, size_t burst_events, Cycles window, std::vector<uint64_t>& t) {
+    if (n == 0) return;
+    t.assign(n + 1, 0); // pulse times from pulse 0
+    for (size_t i = 0; i < n; ++i) {
+      const Cycles g = v[i];
+      t[i + 1] = t[i] + g;
+      gap_sum += (double)g;
+      if (i > 0) {
+        const Cycles p = v[i - 1];
+        jitter_sum += (double)((g > p) ? g - p : p - g);
+        ++jitter_n;
+      }
+      if (g >= max_gap) {
+        max_gap = g;
+        max_gap_age = (stamps && stamps[i] && now >= stamps[i]) ? (int64_t)(now - stamps[i]) : -1;
+      }
+    }
+    gaps += n;
+    if (stamps && stamps[n - 1] && now >= stamps[n - 1]) {
+      const int64_t age = (int64_t)(now - stamps[n - 1]);
+      if (last_age < 0 || age < last_age) last_age = age; // newest pulse over all threads
+    }
+    for (size_t lo = 0, hi = 0; hi <= n; ++hi) { // two pointers over pulse times
+      while (t[hi] - t[lo] > window) ++lo;
+      peak = std::max(peak, hi - lo + 1);
+    }
+    if (burst_events >= 2 && burst_events <= n + 1) {
+      bool in_burst = false;
+      for (size_t k = 0; k + burst_events - 1 <= n; ++k) {
+        const bool dense = (t[k + burst_events - 1] - t[k] <= window);
+        if (dense && !in_burst) ++bursts;
+        in_burst = dense;
+      }
+    }
+  }
+};
+
+inline Text CoreLabel(uint32_t aux) {
+  if (aux == RingBuffer::CORE_UNKNOWN) return Text("cpu ?");
+  return Text("cpu ").Int(aux & 0xFFF).Put(" n").Int(aux >> 12);
+}
+
+#if LATTE_CALL_TREE
+// Merges per-thread call trees by ID path; rows come out depth-first, heaviest child first
+struct CallMerge {
+  struct Node {
+    ID id = nullptr;
+    uint8_t calib_key = CALIB_KEY_UNSET;
+    uint64_t count = 0;
+    Cycles inclusive = 0, self = 0;
+    std::map<ID, size_t> children;
+  };
+  std::vector<Node> nodes = std::vector<Node>(1); // root
+
+  // Caller holds ts->mutex (history lookups here are safe, CallNode::rb is not)
+  void Add(const ThreadStorage* ts) {
+    const uint32_t n = ts->tree_size.load(std::memory_order_acquire);
+    std::vector<size_t> merged(n, SIZE_MAX);
+    merged[0] = 0;
+    for (uint32_t i = 1; i < n; ++i) {
+      const CallNode& c = ts->tree[i];
+      const size_t parent = merged[c.parent]; // parents are created before their children
+      if (parent == SIZE_MAX) continue;
+      uint8_t key = CALIB_KEY_UNSET;
+      if (i != CALL_NODE_FULL) {
+        auto h = ts->history.find(c.id);
+        if (c.id == nullptr || h == ts->history.end()) continue; // unused slot or dropped ring (calibration)
+        key = h->second.calib_key.load(std::memory_order_relaxed);
+      }
+      auto [it, inserted] = nodes[parent].children.emplace(c.id, nodes.size());
+      if (inserted) nodes.emplace_back().id = c.id;
+      merged[i] = it->second;
+      Node& m = nodes[it->second];
+      if (m.calib_key == CALIB_KEY_UNSET) m.calib_key = key;
+      else if (key != CALIB_KEY_UNSET && m.calib_key != key) m.calib_key = CALIB_KEY_MIXED;
+      m.count += c.count.load(std::memory_order_relaxed);
+      m.inclusive += c.inclusive.load(std::memory_order_relaxed);
+      m.self += c.self.load(std::memory_order_relaxed);
+    }
+  }
+
+  void Emit(size_t index, uint32_t depth, std::vector<CallRow>& out) const {
+    std::vector<size_t> kids;
+    for (const auto& [id, k] : nodes[index].children) kids.push_back(k);
+    std::sort(kids.begin(), kids.end(), [&](size_t a, size_t b) { return nodes[a].inclusive > nodes[b].inclusive; });
+    for (size_t k : kids) {
+      const Node& m = nodes[k];
+      if (m.count == 0) continue;
+      out.push_back(CallRow{m.id, depth, m.count, m.inclusive, m.self, m.calib_key});
+      Emit(k, depth + 1, out);
+    }
+  }
+};
+#endif
+
+// Ring read scratch of CollectLive, one per thread (capacity only grows)
+struct CollectBuffers {
+  std::vector<Cycles> raw;
+  std::vector<uint32_t> cores;
+  std::vector<uint64_t> counters;
+  std::vector<int32_t> adjust;     // per-sample core adjustment of the ring being read
+  std::vector<int32_t> core_calib; // CoreCalibration table
+};
+
+// Per-core calibration from MeasureTscSkew: a pair's overhead on a core is taken as the mean back-to-back read cost
+// of its two modes (Lean/Strict: their Start read), so a sample stopped on cpu c adds
+// (cost(c) - cost(calibration cpu)) to its key's offset. table[cpu * CALIB_KEY_COUNT + key]; empty without a skew
+// pass. The reference is the calibrating cpu, else MeasureTscSkew's reference cpu (calibration loaded from cache)
+inline void CoreCalibration(const std::vector<CoreTsc>& cores, int calibration_cpu, std::vector<int32_t>& table) {
+  table.clear();
+  if (cores.empty()) return;
+  const CoreTsc* ref = &cores[0];
+  uint32_t top = 0;
+  for (const CoreTsc& c : cores) {
+    if ((int)c.cpu == calibration_cpu) ref = &c;
+    top = std::max(top, c.cpu);
+  }
+  table.assign(((size_t)top + 1) * CALIB_KEY_COUNT, 0);
+  for (const CoreTsc& c : cores) {
+    for (size_t i = 0; i < CALIB_KEYS.size(); ++i) {
+      const size_t sm = i / MODE_COUNT, em = i % MODE_COUNT;
+      const int64_t d = ((int64_t)(c.overhead[sm] + c.overhead[em]) - (int64_t)(ref->overhead[sm] + ref->overhead[em])) / 2;
+      table[(size_t)c.cpu * CALIB_KEY_COUNT + CALIB_KEYS[i]] = (int32_t)d;
+    }
+  }
+}
+
+inline CollectBuffers& CollectScratch() {
+  thread_local CollectBuffers buffers;
+  return buffers;
+}
+
+// Collected data of the dumps (DumpToStream, DumpToFd, Interval::Write), one per thread, refilled in place
+inline ReportData& ReportDataScratch() {
+  thread_local ReportData data;
+  return data;
+}
+
+// Refills data (ReportData::Clear, then every ring): with the same IDs and sample counts as the last call, nothing is
+// allocated. since: report only samples at or after each ring's cursor (rings missing from it: from 0). Full-run
+// sections (histograms, call tree, migration counts) are cumulative and left out then. next receives every ring's
+// end, and may be since itself (each cursor is read before it is moved)
+inline void CollectLive(ReportData& data, Parameter::Breakdown breakdown = Parameter::Merged, const Cursors* since = nullptr, Cursors* next = nullptr) {
+  Manager& mgr = Manager::Get();
+  data.Clear();
+  data.cycles_per_ns = mgr.cycles_per_ns;
+  for (size_t k = 0; k < CALIB_KEY_COUNT; ++k) data.calib_offsets[k] = mgr.CalibrationOffset((uint8_t)k);
+
+  // Thread-safe data collection (lock-free snapshot of each ring, writers keep running)
+  CollectBuffers& scratch = CollectScratch();
+  std::vector<Cycles>& raw = scratch.raw;
+  std::vector<uint32_t>& cores = scratch.cores;
+  std::vector<uint64_t>& counters = scratch.counters;
+  std::vector<int32_t>& adjust = scratch.adjust;
+  const std::vector<int32_t>& core_calib = scratch.core_calib;
+  // Samples with a core adjustment (when one ring of a series has them, the others pad with 0)
+  auto append = [](Series& dst, const Cycles* v, const int32_t* a, size_t n) {
+    if (a || !dst.core_adjust.empty()) {
+      dst.core_adjust.resize(dst.values.size(), 0);
+      if (a) dst.core_adjust.insert(dst.core_adjust.end(), a, a + n);
+      else dst.core_adjust.resize(dst.values.size() + n, 0);
+    }
+    dst.values.insert(dst.values.end(), v, v + n);
+  };
+  data.invariant_tsc = InvariantTsc() ? 1 : 0;
+  data.pmu_events = mgr.pmu_events;
+#if LATTE_CALL_TREE
+  CallMerge tree;
+#endif
+  std::lock_guard<std::mutex> lock(mgr.mutex);
+  data.tsc_cores = mgr.tsc_cores;
+  CoreCalibration(data.tsc_cores, mgr.calibration_cpu.load(std::memory_order_relaxed), scratch.core_calib);
+  for (size_t t = 0; t < mgr.thread_buffers.size(); ++t) {
+    ThreadStorage* ts = mgr.thread_buffers[t];
+    std::lock_guard<std::mutex> ts_lock(ts->mutex);
+    data.placement.push_back(Placement{ts->cpu, ts->node, ts->home, ts->arena.PageKind(), ts->arena.Mapped()});
+#if LATTE_CALL_TREE
+    if (!since) tree.Add(ts);
+#endif
+    if (breakdown == Parameter::PerThread) {
+      Text& label = data.part_labels[(uint32_t)t];
+      label = Text();
+      label.Put('T').Int(t).Put(' ');
+      if (ts->name[0]) label.Put(std::string_view(ts->name, strnlen(ts->name, sizeof(ts->name)))).Put(':');
+      label.Int(ts->tid);
+    }
+    for (auto& [id, buffer] : ts->history) {
+      Series& s = data.series[id];
+      const uint8_t key = buffer.calib_key.load(std::memory_order_relaxed);
+      s.MergeKey(key);
+      if (!since) {
+        if (buffer.hist) data.histograms[id].Merge(*buffer.hist);
+        if (const uint64_t m = buffer.migrations.load(std::memory_order_relaxed)) data.migrations[id] += m;
+      }
+
+      raw.clear();
+      cores.clear();
+      counters.clear();
+      const uint64_t from = since ? CursorFrom(*since, ts, id, buffer) : 0;
+      const bool pulse = (key == CALIB_KEY_PULSE);
+      const bool per_core = !core_calib.empty() && buffer.cores && key < CALIB_KEY_COUNT && !pulse;
+      const size_t stamp_base = data.pulse_stamps.size();
+      const RingBuffer::Window w = buffer.Read(raw, from, ((breakdown == Parameter::PerCore || per_core) && buffer.cores) ? &cores : nullptr,
+                                               buffer.pmu ? &counters : nullptr, (pulse && buffer.stamps) ? &data.pulse_stamps : nullptr);
+      if (next) (*next)[{ts, id}] = RingCursor{buffer.generation, w.end};
+      if (buffer.pmu) {
+        PmuTotals& p = data.pmu[id];
+        p.n += raw.size();
+        for (size_t i = 0; i < counters.size(); ++i) p.sum[i % PMU_COUNTERS] += (double)counters[i];
+      }
+      if (pulse && !raw.empty()) {
+        data.pulses[id].push_back(PulseRun{s.values.size(), raw.size(), (data.pulse_stamps.size() > stamp_base) ? stamp_base : PulseRun::NO_STAMPS});
+      }
+      const int32_t* a = nullptr;
+      if (per_core) {
+        adjust.resize(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+          const size_t k = (size_t)(cores[i] & 0xFFF) * CALIB_KEY_COUNT + key;
+          adjust[i] = (cores[i] != RingBuffer::CORE_UNKNOWN && k < core_calib.size()) ? core_calib[k] : 0;
+        }
+        a = adjust.data();
+      }
+      append(s, raw.data(), a, raw.size());
+
+      if (breakdown == Parameter::PerThread) {
+        Series& part = data.parts[id][(uint32_t)t];
+        part.MergeKey(key);
+        append(part, raw.data(), a, raw.size());
+      } else if (breakdown == Parameter::PerCore && buffer.cores) {
+        auto& parts = data.parts[id];
+        for (size_t i = 0; i < raw.size(); ++i) {
+          const uint32_t core = (cores[i] == RingBuffer::CORE_UNKNOWN) ? cores[i] : (cores[i] & ~RingBuffer::CORE_MIGRATED);
+          Series& part = parts[core];
+          part.MergeKey(key);
+          append(part, &raw[i], a ? a + i : nullptr, 1);
+        }
+      }
+    }
+  }
+  data.now_tsc = Intrinsic::RDTSC(); // after every read: no stamp is newer
+  if (breakdown == Parameter::PerCore) {
+    for (auto& [id, parts] : data.parts)
+      for (auto& [aux, part] : parts) {
+        if (!part.values.empty()) data.part_labels[aux] = CoreLabel(aux); // keys may hold thread labels from an earlier pass
+      }
+  }
+  // Side sections print when their map is non-empty: drop what this pass left empty
+  auto prune = [](auto& m, auto&& empty) {
+    for (auto it = m.begin(); it != m.end();) it = empty(it->second) ? m.erase(it) : std::next(it);
+  };
+  prune(data.histograms, [](const Histogram& h) { return h.total == 0; });
+  prune(data.migrations, [](uint64_t m) { return m == 0; });
+  prune(data.pmu, [](const PmuTotals& p) { return p.n == 0; });
+  prune(data.pulses, [](const std::vector<PulseRun>& r) { return r.empty(); });
+#if LATTE_CALL_TREE
+  tree.Emit(0, 0, data.call_tree);
+#endif
+}
+
+inline ReportData CollectLive(Parameter::Breakdown breakdown = Parameter::Merged, const Cursors* since = nullptr, Cursors* next = nullptr) {
+  ReportData data;
+  CollectLive(data, breakdown, since, next);
+  return data;
+}
+
+// Row order of a report: merged rows, then their breakdown rows (label: thread / core, nullptr when unlabeled)
+struct ReportRow {
+  ID id;
+  const Series* series;
+  const Text* label;
+  uint32_t key;
+  bool part;
+};
+
+// Report working set, one per thread, reused across reports (capacity only grows): the text (sent with a single
+// write), the row order and the statistics, whose percentile vectors keep their capacity
+struct ReportBuffers {
+  std::string text;
+  std::vector<ReportRow> rows;
+  std::vector<Stats> stats;
+  std::string rule, frame;
+  std::vector<uint64_t> times; // PulseStats::Scan
+};
+
+inline ReportBuffers& ReportScratch() {
+  thread_local ReportBuffers buffers;
+  return buffers;
+}
+
+inline void AppendCsv(std::string& out, std::string_view s) {
+  if (s.find_first_of(",\"\r\n") == std::string_view::npos) { out += s; return; }
+  out += '"';
+  for (char c : s) {
+    if (c == '"') out += '"';
+    out += c;
+  }
+  out += '"';
+}
+
+inline void AppendJson(std::string& out, std::string_view s) {
+  out += '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') { out += '\\'; out += c; }
+    else if ((unsigned char)c < 0x20) {
+      const char* hex = "0123456789abcdef";
+      out += "\\u00";
+      out += hex[(unsigned char)c >> 4];
+      out += hex[c & 0xF];
+    } else out += c;
+  }
+  out += '"';
+}
+
+inline void FormatReport(std::string& out, const ReportData& data, const ReportOptions& opt) {
+  const std::map<ID, Series>& global_data = data.series;
+  const Parameter::Unit unit = opt.unit;
+  const Parameter::Data data_mode = opt.data;
+
+  auto ToDisp = [&](double cycles) {
+    return (unit == Parameter::Time) ? TimeText(cycles / data.cycles_per_ns) : LargeText(cycles);
+  };
+
+  // Raw values: integers as is, fractional statistics with two decimals, large ones with K/M/B suffixes
+  auto ValueDisp = [](double v) {
+    if (v >= 1000.0) return LargeText(v);
+    return Text().Fixed(v, v == std::floor(v) ? 0 : 2);
+  };
+
+  // Statistics per row in parallel (no lock held: data is already a private copy), rows in map order.
+  // Breakdown rows (per thread / per core) follow their ID's merged row; value IDs (Latte::Record) come last
+  ReportBuffers& scratch = ReportScratch();
+  std::vector<ReportRow>& order = scratch.rows;
+  order.clear();
+  size_t first_value = 0;
+  for (int values = 0; values < 2; ++values) {
+    for (const auto& [id, series] : global_data) {
+      if (series.values.empty() || (series.calib_key == Internal::CALIB_KEY_VALUE) != (values == 1)) continue;
+      order.push_back(ReportRow{id, &series, nullptr, 0, false});
+      auto parts = data.parts.find(id);
+      if (parts == data.parts.end()) continue;
+      for (const auto& [key, part] : parts->second) {
+        if (part.values.empty()) continue;
+        auto label = data.part_labels.find(key);
+        order.push_back(ReportRow{id, &part, (label != data.part_labels.end()) ? &label->second : nullptr, key, true});
+      }
+    }
+    if (values == 0) first_value = order.size();
+  }
+  std::vector<Internal::Stats>& stats = scratch.stats;
+  stats.resize(order.size());
+  Internal::ParallelFor(order.size(), opt.threads, [&](size_t i) {
+    const Series& series = *order[i].series;
+    if (i >= first_value) { Internal::ComputeStats(series, 0, opt.percentiles, false, stats[i]); return; }
+    const Cycles off = (data_mode == Parameter::Calibrated) ? data.CalibrationOffset(series.calib_key) : 0;
+    Internal::ComputeStats(series, off, opt.percentiles, true, stats[i]); // user-extracted cleaning function
+  });
+
+  auto id_name = [](ID id) { return std::string_view((id != nullptr) ? id : "<null-id>"); };
+  auto part_name = [](const ReportRow& r) { return r.label ? *r.label : Text().Int(r.key); };
+  auto pct_label = [](double p) { return Text().Put('P').General(p, 6); };
+
+  out.clear();
+
+  // Machine-readable layouts: the statistics rows only, one record per row, numbers without suffixes
+  // (cycles, or ns with Parameter::Time; value rows raw)
+  if (opt.layout == Parameter::Csv || opt.layout == Parameter::Json) {
+    const bool csv = (opt.layout == Parameter::Csv);
+    out.reserve((order.size() + 2) * (160 + 24 * opt.percentiles.size()));
+    auto num = [&](double v, bool value) {
+      if (!value && unit == Parameter::Time) v /= data.cycles_per_ns;
+      if (!std::isfinite(v)) { out += csv ? "" : "null"; return; }
+      out += Text().Fixed(v, v == std::floor(v) ? 0 : 2);
+    };
+    const char* unit_name = (unit == Parameter::Time) ? "ns" : "cycles";
+
+    if (csv) {
+      out += "id,part,kind,unit,samples,avg,median";
+      for (double p : opt.percentiles) { out += ','; out += pct_label(p); }
+      out += ",std_dev,skew,min,max,range,bypass,sum,saturated\n";
+    } else {
+      out += "{\"unit\":\"";
+      out += unit_name;
+      out += "\",\"data\":\"";
+      out += (data_mode == Parameter::Calibrated) ? "calibrated" : "raw";
+      out += "\",\"interval_ns\":";
+      out += Text().Fixed(data.interval_ns, 0);
+      out += ",\"rows\":[";
+    }
+    bool first = true;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const Internal::Stats& st = stats[i];
+      if (st.n == 0) continue;
+      const ReportRow& r = order[i];
+      const bool value = (i >= first_value);
+      if (csv) {
+        AppendCsv(out, id_name(r.id));
+        out += ',';
+        if (r.part) AppendCsv(out, part_name(r));
+        out += value ? ",value," : ",timing,";
+        if (!value) out += unit_name;
+        out += ',';
+        out += Text().Int(st.n);
+        for (double v : {st.avg, st.median}) { out += ','; num(v, value); }
+        for (double v : st.percentiles) { out += ','; num(v, value); }
+        out += ',';
+        num(st.std_dev, value);
+        out += ',';
+        if (std::isfinite(st.skew)) out += Text().Fixed(st.skew, 2);
+        for (double v : {st.min, st.max, st.max - st.min}) { out += ','; num(v, value); }
+        out += ',';
+        if (!value) out += Text().Int(st.bypass);
+        out += ',';
+        if (value) num(st.avg * (double)st.n, true);
+        out += ',';
+        out += Text().Int(st.saturated);
+        out += '\n';
+      } else {
+        out += first ? "\n{\"id\":" : ",\n{\"id\":";
+        AppendJson(out, id_name(r.id));
+        out += ",\"part\":";
+        if (r.part) AppendJson(out, part_name(r));
+        else out += "null";
+        out += value ? ",\"kind\":\"value\",\"samples\":" : ",\"kind\":\"timing\",\"samples\":";
+        out += Text().Int(st.n);
+        out += ",\"avg\":";
+        num(st.avg, value);
+        out += ",\"median\":";
+        num(st.median, value);
+        out += ",\"percentiles\":{";
+        for (size_t k = 0; k < st.percentiles.size() && k < opt.percentiles.size(); ++k) {
+          if (k) out += ',';
+          out += '"';
+          out += pct_label(opt.percentiles[k]);
+          out += "\":";
+          num(st.percentiles[k], value);
+        }
+        out += "},\"std_dev\":";
+        num(st.std_dev, value);
+        out += ",\"skew\":";
+        if (std::isfinite(st.skew)) out += Text().Fixed(st.skew, 2);
+        else out += "null";
+        out += ",\"min\":";
+        num(st.min, value);
+        out += ",\"max\":";
+        num(st.max, value);
+        if (value) { out += ",\"sum\":"; num(st.avg * (double)st.n, true); }
+        else { out += ",\"bypass\":"; out += Text().Int(st.bypass); }
+        out += ",\"saturated\":";
+        out += Text().Int(st.saturated);
+        out += '}';
+      }
+      first = false;
+    }
+    if (!csv) out += "\n]}\n";
+    return;
+  }
+
+  // Column Widths
+  const int C1 = 20;
+  const int C2 = 9;
+  const int C3 = 10;
+  const int C4 = 10;
+  const int C5 = 10;
+  const int C6 = 8;
+  const int C7 = 10;
+  const int C8 = 10;
+  const int C9 = 10;
+  const int C_BY = 10;
+  const int C_P = 10; // one per percentile
+  const int C_H = 10; // every value column of the full run histogram (widens the table when that section is printed)
+
+  const int COL_COUNT = 10 + (int)opt.percentiles.size();
+  const int MAIN_WIDTH = C1 + C2 + C3 + C4 + C5 + C6 + C7 + C8 + C9 + C_BY + C_P * (int)opt.percentiles.size() + (3*(COL_COUNT-1)+2);
+  const int HIST_WIDTH = C1 + C2 + C_H * 8 + (3*9+2);
+  const int TABLE_WIDTH = std::max(MAIN_WIDTH, data.histograms.empty() ? 0 : HIST_WIDTH);
+  // Borders built once per report (in the scratch, like the text): gray ANSI wrappers in the Table layout, bare in Plain
+  const bool ansi = (opt.layout == Parameter::Table);
+  const std::string_view GRAY = ansi ? "\033[90m" : "", RESET = ansi ? "\033[0m" : "";
+  auto gray = [&](std::string& g, std::string_view s, size_t fill = 0, char c = ' ') {
+    g += GRAY;
+    g += s;
+    g.append(fill, c);
+    g += RESET;
+  };
+  std::string bar, sep; // short enough for the small-string buffer
+  gray(bar, "|");
+  gray(sep, " | ");
+  auto border = [&](std::string& b, std::string_view edge, char c) {
+    b.clear();
+    gray(b, edge);
+    gray(b, "", (size_t)TABLE_WIDTH, c);
+    gray(b, edge);
+    b += '\n';
+  };
+  std::string& rule = scratch.rule;
+  std::string& frame = scratch.frame;
+  border(rule, "|", '-');
+  border(frame, "#", '=');
+
+  const size_t lines = order.size() + data.pulses.size() + data.call_tree.size() + data.pmu.size() + data.histograms.size() + 40;
+  out.reserve(lines * (size_t)(TABLE_WIDTH + (ansi ? 10 * COL_COUNT : 0) + 4));
+
+  // Cells are views: the text (a Text temporary or a literal) must outlive the row call.
+  // Rows narrower than the table (fixed-column sections) are padded to the right border
+  struct Cell {
+    std::string_view text;
+    int width;
+    bool left;
+  };
+  auto col = [](std::string_view s, int width, bool left = false) { return Cell{s, width, left}; };
+  size_t used = 0, cells = 0;
+  auto open = [&]() {
+    out += bar;
+    out += ' ';
+    used = cells = 0;
+  };
+  auto put = [&](const Cell& c, bool joined = false) {
+    if (cells++ > 0 && !joined) { out += sep; used += 3; }
+    const size_t n = std::min(c.text.size(), (size_t)c.width);
+    if (!c.left) out.append((size_t)c.width - n, ' ');
+    out.append(c.text.data(), n);
+    if (c.left) out.append((size_t)c.width - n, ' ');
+    used += (size_t)c.width;
+  };
+  auto close = [&]() {
+    if (used < (size_t)TABLE_WIDTH - 2) out.append((size_t)TABLE_WIDTH - 2 - used, ' ');
+    out += ' ';
+    out += bar;
+    out += '\n';
+  };
+  auto write_row = [&](std::initializer_list<Cell> row) {
+    open();
+    for (const Cell& c : row) put(c);
+    close();
+  };
+  // Free text across the whole row, appended in place and cut at the border
+  auto text_row = [&](auto&& fill) {
+    open();
+    const size_t start = out.size();
+    fill();
+    if (out.size() - start > (size_t)TABLE_WIDTH - 2) out.resize(start + (size_t)TABLE_WIDTH - 2);
+    used = out.size() - start;
+    close();
+  };
+  auto title_row = [&](std::string_view s) { write_row({col(s, TABLE_WIDTH - 2, true)}); };
+
+  out += '\n';
+  out += frame;
+  text_row([&]() {
+    out += (unit == Parameter::Time) ? "LATTE TELEMETRY [TIME]" : "LATTE TELEMETRY [CYCLES]";
+    out += (data_mode == Parameter::Calibrated) ? "[CAL]" : "[RAW]";
+    if (data.interval_ns > 0) { out += "[INTERVAL "; out += TimeText(data.interval_ns); out += ']'; }
+  });
+  out += frame;
+
+
+  // Removing overhead measured by your Latte-calls themself (noise)
+  if (data_mode == Parameter::Calibrated) {
+    auto off_disp = [&](uint8_t key) { return ToDisp((double)data.CalibrationOffset(key)); };
+
+    constexpr int MW = 14;
+    auto letter = [](size_t m) { return std::string_view(&Internal::MODE_LETTERS[m], 1); };
+
+    // F/M/H/L/S: Fast, Mid, Hard, Lean, Strict
+    title_row("OVERHEAD H[Start] x W[Stop]");
+    open();
+    put(col("", 10, true));
+    for (size_t em = 0; em < MODE_COUNT; ++em) put(col(letter(em), MW), true);
+    close();
+    for (uint8_t sm = 0; sm < MODE_COUNT; ++sm) {
+      open();
+      put(col(letter(sm), 10, true));
+      for (uint8_t em = 0; em < MODE_COUNT; ++em) put(col(off_disp(Internal::CalibKey(sm, em)), MW), true);
+      close();
+    }
+    open();
+    put(col("PULSE", 10, true));
+    put(col(off_disp(Internal::CALIB_KEY_PULSE), MW), true);
+    for (size_t em = 1; em < MODE_COUNT; ++em) put(col("", MW), true);
+    close();
+    out += rule;
+  }
+
+  auto write_header = [&](std::string_view last) {
+    open();
+    put(col("COMPONENT", C1, true));
+    put(col("SAMPLES", C2));
+    put(col("AVG", C3));
+    put(col("MEDIAN", C4));
+    for (double p : opt.percentiles) put(col(pct_label(p), C_P));
+    put(col("STD DEV", C5));
+    put(col("SKEW", C6));
+    put(col("MIN", C7));
+    put(col("MAX", C8));
+    put(col("RANGE", C9));
+    put(col(last, C_BY));
+    close();
+  };
+  write_header("BYPASS");
+  out += rule;
+
+  auto write_stats = [&](size_t i, bool value) {
+    const Internal::Stats& st = stats[i];
+    auto disp = [&](double v) { return value ? ValueDisp(v) : ToDisp(v); };
+    open();
+    if (order[i].part) put(col(Text("  ").Put(part_name(order[i])), C1, true));
+    else put(col(id_name(order[i].id), C1, true));
+    put(col(Text().Int(st.n), C2));
+    put(col(disp(st.avg), C3));
+    put(col(disp(st.median), C4));
+    for (double v : st.percentiles) put(col(disp(v), C_P));
+    put(col(disp(st.std_dev), C5));
+    put(col(Text().Fixed(st.skew, 2), C6));
+    put(col(disp(st.min), C7));
+    put(col(disp(st.max), C8));
+    put(col(disp(st.max - st.min), C9));
+    put(col(value ? ValueDisp(st.avg * (double)st.n) : Text().Int(st.bypass), C_BY));
+    close();
+  };
+
+  for (size_t i = 0; i < first_value; ++i) {
+    if (stats[i].n == 0) continue;
+    write_stats(i, false);
+  }
+
+  // Value probes: unit-less, never calibrated or cleaned
+  if (first_value < order.size()) {
+    out += rule;
+    title_row("VALUES (Latte::Record / LATTE_VALUE: raw, uncalibrated, not cleaned)");
+    write_header("SUM");
+    out += rule;
+    for (size_t i = first_value; i < order.size(); ++i) {
+      if (stats[i].n == 0) continue;
+      write_stats(i, true);
+    }
+  }
+
+  // Compact rings: escaped samples whose overflow entry was reused before the read. Their value is lost,
+  // so they are left out of every statistic above (the FULL RUN HISTOGRAM recorded them at push time)
+  size_t saturated = 0;
+  for (size_t i = 0; i < order.size(); ++i) saturated += order[i].part ? 0 : stats[i].saturated;
+  if (saturated) {
+    out += rule;
+    text_row([&]() {
+      out += "SATURATED (Compact escapes lost, excluded):";
+      for (size_t i = 0; i < order.size(); ++i) {
+        if (order[i].part || stats[i].saturated == 0) continue;
+        out += "  ";
+        out += id_name(order[i].id);
+        out += ' ';
+        out += Text().Int(stats[i].saturated);
+      }
+    });
+  }
+
+  // Pulse IDs: rate, jitter, longest gap, bursts; from the raw gaps (never calibrated, also in CAL reports), before cleaning
+  if (!data.pulses.empty()) {
+    const Cycles window = (Cycles)(opt.burst_window_ns * data.cycles_per_ns);
+    out += rule;
+    text_row([&]() {
+      out += "PULSE (JITTER = mean |gap change|, BURSTS: runs of ";
+      out += Text().Int(opt.burst_events);
+      out += " pulses within ";
+      out += TimeText(opt.burst_window_ns);
+      out += ", PEAK = most pulses within it, AGO/LAST need IdOptions::timestamps)";
+    });
+    write_row({
+      col("COMPONENT", C1, true),
+      col("GAPS", C2),
+      col("RATE /s", C3),
+      col("MEAN GAP", C4),
+      col("JITTER", C5),
+      col("MAX GAP", C7),
+      col("GAP AGO", C8),
+      col("LAST AGO", C9),
+      col("BURSTS", C_BY),
+      col("PEAK", C6)
+    });
+    out += rule;
+    for (const auto& [id, runs] : data.pulses) {
+      auto it = data.series.find(id);
+      if (it == data.series.end()) continue;
+      PulseStats p;
+      for (const PulseRun& r : runs) {
+        p.Scan(it->second.values.data() + r.begin, r.count, data.Stamps(r), data.now_tsc, opt.burst_events, window, scratch.times);
+      }
+      if (p.gaps == 0) continue;
+      const double mean = p.gap_sum / (double)p.gaps;
+      auto age = [&](int64_t a) { return (a < 0) ? Text("-") : ToDisp((double)a); };
+      write_row({
+        col(id_name(id), C1, true),
+        col(Text().Int(p.gaps), C2),
+        col((mean > 0) ? LargeText(1e9 * data.cycles_per_ns / mean) : Text("-"), C3),
+        col(ToDisp(mean), C4),
+        col(p.jitter_n ? ToDisp(p.jitter_sum / (double)p.jitter_n) : Text("-"), C5),
+        col(ToDisp((double)p.max_gap), C7),
+        col(age(p.max_gap_age), C8),
+        col(age(p.last_age), C9),
+        col(opt.burst_events >= 2 ? Text().Int(p.bursts) : Text("-"), C_BY),
+        col(Text().Int(p.peak), C6)
+      });
+    }
+  }
+
+  // Call tree (LATTE_CALL_TREE): totals per call path; calibration removes each pair's own overhead once per call
+  if (!data.call_tree.empty()) {
+    const int CT = C1 + C2 + 3;
+    out += rule;
+    title_row("CALL TREE (self = inclusive - children)");
+    write_row({
+      col("PATH", CT, true),
+      col("CALLS", C3),
+      col("INCL AVG", C4),
+      col("SELF AVG", C5),
+      col("INCL TOTAL", C7),
+      col("SELF TOTAL", C8),
+      col("SELF %", C6)
+    });
+    out += rule;
+    for (const CallRow& r : data.call_tree) {
+      const double off = (data_mode == Parameter::Calibrated) ? (double)data.CalibrationOffset(r.calib_key) * (double)r.count : 0.0;
+      const double incl = std::max(0.0, (double)r.inclusive - off);
+      const double self = std::max(0.0, (double)r.self - off);
+      Text path;
+      for (uint32_t d = 0; d < r.depth && path.n < (size_t)CT; ++d) path.Put("  ");
+      path.Put((r.id != nullptr) ? r.id : "<call tree full>");
+      write_row({
+        col(path, CT, true),
+        col(Text().Int(r.count), C3),
+        col(ToDisp(incl / (double)r.count), C4),
+        col(ToDisp(self / (double)r.count), C5),
+        col(ToDisp(incl), C7),
+        col(ToDisp(self), C8),
+        col(Text().Fixed(incl > 0 ? 100.0 * self / incl : 0.0, 1), C6)
+      });
+    }
+  }
+
+  // Hardware counters (Latte::Pmu): mean delta per sample, IPC and misses per 1000 instructions
+  if (!data.pmu.empty()) {
+    auto slot = [&](PmuEvent e) -> int {
+      for (size_t k = 0; k < PMU_COUNTERS; ++k) if (data.pmu_events[k] == e) return (int)k;
+      return -1;
+    };
+    const int cyc = slot(PmuEvent::CoreCycles), ins = slot(PmuEvent::Instructions);
+    const int cm = slot(PmuEvent::CacheMisses), bm = slot(PmuEvent::BranchMisses);
+    const char* names[] = {"", "CYCLES", "INSTR", "CACHE MISS", "BR MISS"};
+
+    out += rule;
+    title_row("PMU (mean delta per sample, user space)");
+    open();
+    put(col("COMPONENT", C1, true));
+    put(col("SAMPLES", C2));
+    put(col("IPC", C3));
+    for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+      if (data.pmu_events[k] != PmuEvent::None) put(col(names[(size_t)data.pmu_events[k]], C4));
+    }
+    put(col("CM/KI", C5));
+    put(col("BM/KI", C5));
+    close();
+    out += rule;
+
+    for (const auto& [id, p] : data.pmu) {
+      if (p.n == 0) continue;
+      auto per_ki = [&](int k) { return (k >= 0 && ins >= 0 && p.sum[ins] > 0) ? Text().Fixed(1000.0 * p.sum[k] / p.sum[ins], 2) : Text("-"); };
+      open();
+      put(col(id_name(id), C1, true));
+      put(col(Text().Int(p.n), C2));
+      put(col((cyc >= 0 && ins >= 0 && p.sum[cyc] > 0) ? Text().Fixed(p.sum[ins] / p.sum[cyc], 2) : Text("-"), C3));
+      for (size_t k = 0; k < PMU_COUNTERS; ++k) {
+        if (data.pmu_events[k] != PmuEvent::None) put(col(LargeText(p.sum[k] / (double)p.n), C4));
+      }
+      put(col(per_ki(cm), C5));
+      put(col(per_ki(bm), C5));
+      close();
+    }
+  }
+
+  // TSC domain: invariant flag, measured inter-core skew, samples that migrated between Start and Stop
+  if (!data.tsc_cores.empty() || !data.migrations.empty()) {
+    out += rule;
+    text_row([&]() {
+      out += "TSC  invariant: ";
+      out += (data.invariant_tsc < 0 ? "?" : (data.invariant_tsc ? "yes" : "NO"));
+      if (!data.tsc_cores.empty()) {
+        const CoreTsc* worst = &data.tsc_cores[0];
+        Cycles rtt = 0;
+        for (const CoreTsc& c : data.tsc_cores) {
+          if (std::llabs(c.offset) > std::llabs(worst->offset)) worst = &c;
+          rtt = std::max(rtt, c.rtt);
+        }
+        out += "  cores: ";
+        out += Text().Int(data.tsc_cores.size());
+        out += "  max skew: ";
+        out += Text().Int(worst->offset);
+        out += " cycles (cpu ";
+        out += Text().Int(worst->cpu);
+        out += ")  max rtt: ";
+        out += Text().Int(rtt);
+        out += " cycles";
+      } else {
+        out += "  skew: not measured (Manager::MeasureTscSkew)";
+      }
+    });
+    // Per core: offset to the reference CPU, round trip, back-to-back read cost per mode (compare with OVERHEAD)
+    if (!data.tsc_cores.empty()) {
+      open();
+      put(col("CPU", C1, true));
+      put(col("OFFSET", C2));
+      put(col("RTT", C3));
+      for (size_t m = 0; m < MODE_COUNT; ++m) put(col(Text("READ ").Put(Internal::MODE_LETTERS[m]), C4));
+      close();
+      for (const CoreTsc& c : data.tsc_cores) {
+        open();
+        put(col(Text().Int(c.cpu), C1, true));
+        put(col(ToDisp((double)c.offset), C2));
+        put(col(ToDisp((double)c.rtt), C3));
+        for (size_t m = 0; m < MODE_COUNT; ++m) put(col(ToDisp((double)c.overhead[m]), C4));
+        close();
+      }
+    }
+    if (!data.migrations.empty()) {
+      text_row([&]() {
+        out += "MIGRATED (start core != stop core):";
+        for (const auto& [id, n] : data.migrations) {
+          out += "  ";
+          out += id_name(id);
+          out += ' ';
+          out += Text().Int(n);
+        }
+      });
+    }
+  }
+
+  // Memory placement: storages on their owner's node, page size backing the rings
+  if (!data.placement.empty()) {
+    size_t local = 0, known = 0, mapped = 0;
+    std::array<size_t, 3> kinds{};
+    for (const Placement& p : data.placement) {
+      if (p.node >= 0 && p.home >= 0) { ++known; local += (p.node == p.home); }
+      ++kinds[(size_t)p.pages];
+      mapped += p.mapped;
+    }
+    out += rule;
+    text_row([&]() {
+      out += "NUMA  nodes: ";
+      out += Text().Int(NumaNodes());
+      out += "  threads: ";
+      out += Text().Int(data.placement.size());
+      if (known) { out += "  local storage: "; out += Text().Int(local).Put('/').Int(known); }
+      out += "  arena: ";
+      out += Text().Int(mapped >> 20);
+      out += " MiB  ring pages: 4K x";
+      out += Text().Int(kinds[(size_t)Pages::Small]);
+      if (kinds[(size_t)Pages::Transparent]) { out += ", THP x"; out += Text().Int(kinds[(size_t)Pages::Transparent]); }
+      if (kinds[(size_t)Pages::Huge]) { out += ", 2M x"; out += Text().Int(kinds[(size_t)Pages::Huge]); }
+    });
+  }
+
+  // Full-run distribution (no cleaning, no ring window): every sample since the buffer was created
+  if (!data.histograms.empty()) {
+    out += rule;
+    title_row("FULL RUN HISTOGRAM (all samples, <= 3.2% bucket error)");
+    write_row({
+      col("COMPONENT", C1, true),
+      col("COUNT", C2),
+      col("AVG", C_H),
+      col("P50", C_H),
+      col("P90", C_H),
+      col("P99", C_H),
+      col("P99.9", C_H),
+      col("P99.99", C_H),
+      col("MIN", C_H),
+      col("MAX", C_H)
+    });
+    out += rule;
+    for (const auto& [id, h] : data.histograms) {
+      if (h.total == 0) continue;
+      auto it = global_data.find(id);
+      const uint8_t key = (it != global_data.end()) ? it->second.calib_key : Internal::CALIB_KEY_UNSET;
+      const double off = (data_mode == Parameter::Calibrated) ? (double)data.CalibrationOffset(key) : 0.0;
+      const bool value = (key == Internal::CALIB_KEY_VALUE);
+      auto adj = [&](double v) { return std::max(0.0, v - off); };
+      auto disp = [&](double v) { return value ? ValueDisp(v) : ToDisp(v); };
+
+      write_row({
+        col(id_name(id), C1, true),
+        col(Text().Int(h.total), C2),
+        col(disp(adj(h.Mean())), C_H),
+        col(disp(adj(h.Percentile(50.0))), C_H),
+        col(disp(adj(h.Percentile(90.0))), C_H),
+        col(disp(adj(h.Percentile(99.0))), C_H),
+        col(disp(adj(h.Percentile(99.9))), C_H),
+        col(disp(adj(h.Percentile(99.99))), C_H),
+        col(disp(adj((double)h.min)), C_H),
+        col(disp(adj((double)h.max)), C_H)
+      });
+    }
   }
+
+  out += '#';
+  out.append((size_t)TABLE_WIDTH, '=');
+  out += "#\n";
 }
 
-inline std::vector<Cycles> Snapshot(ID id) {
-  return Manager::Get().ExtractRaw(id);
+inline void WriteReport(std::ostream& oss, const ReportData& data, const ReportOptions& opt) {
+  std::string& out = ReportScratch().text;
+  FormatReport(out, data, opt);
+  oss.write(out.data(), (std::streamsize)out.size());
+  oss.flush();
 }
+    }
 
-inline std::string FormatTime(double ns) {
-  std::stringstream ss;
-  ss << std::fixed << std::setprecision(2);
-  if (ns < 1000.0)  ss << ns << " ns";
-  else if (ns < 1e6) ss << (ns / 1e3) << " us";
-  else if (ns < 1e9) ss << (ns / 1e6) << " ms";
-  else if (ns < 60e9) ss << (ns / 1e9) << " s";
-  else ss << (ns / 60e9) << " min";
+inline void DumpToStream(std::ostream& oss, const ReportOptions& opt) {
+  if (opt.unit == Parameter::Time || opt.data == Parameter::Calibrated) {
+    Manager::Get().EnsureCalibrated();
+  }
+  Internal::ReportData& data = Internal::ReportDataScratch();
+  Internal::CollectLive(data, opt.breakdown);
+  Internal::WriteReport(oss, data, opt);
+}
 
-  return ss.str();
+inline void DumpToStream(std::ostream& oss, Parameter::Unit unit = Parameter::Cycle, Parameter::Data data_mode = Parameter::Raw) {
+  ReportOptions opt;
+  opt.unit = unit;
+  opt.data = data_mode;
+  DumpToStream(oss, opt);
 }
 
-namespace Parameter {
-enum Unit { Cycle, Time };
-enum Data { Raw, Calibrated };
+#if defined(__linux__)
+// Same report straight to a file descriptor (stdout: 1): the whole text in one write(2), more only after a partial write
+inline bool DumpToFd(int fd, const ReportOptions& opt) {
+  if (opt.unit == Parameter::Time || opt.data == Parameter::Calibrated) {
+    Manager::Get().EnsureCalibrated();
+  }
+  Internal::ReportData& data = Internal::ReportDataScratch();
+  Internal::CollectLive(data, opt.breakdown);
+  std::string& out = Internal::ReportScratch().text;
+  Internal::FormatReport(out, data, opt);
+  for (size_t done = 0; done < out.size();) {
+    const ssize_t n = ::write(fd, out.data() + done, out.size() - done);
+    if (n <= 0) return false;
+    done += (size_t)n;
+  }
+  return true;
+}
+#endif
+
+// Report window: only samples recorded after the last Begin / Cut. Per-ring cursors on the reader side,
+// so recording threads are untouched and nothing is cleared. Samples overwritten before a cut are lost to it
+class Interval {
+public:
+  Interval() { Begin(); }
+
+  // Starts the window at every ring's current head
+  void Begin() {
+    Manager& mgr = Manager::Get();
+    Internal::Cursors c;
+    {
+      std::lock_guard<std::mutex> lock(mgr.mutex);
+      for (auto* ts : mgr.thread_buffers) {
+        std::lock_guard<std::mutex> ts_lock(ts->mutex);
+        for (auto& [id, buffer] : ts->history) c[{ts, id}] = Internal::RingCursor{buffer.generation, buffer.head.load(std::memory_order_acquire)};
+      }
     }
+    cursors.swap(c);
+    begin_tsc = Intrinsic::RDTSC();
+  }
 
-inline Internal::CleanResult DataClean(const std::vector<double>& values) {
-  return Internal::CleanData(values);
+  // Samples since the window start; restart = true begins the next window exactly where this one ends
+  Internal::ReportData Collect(Parameter::Breakdown breakdown = Parameter::Merged, bool restart = true) {
+    Internal::ReportData data;
+    Collect(data, breakdown, restart);
+    return data;
+  }
+
+  // Same, refilling data in place. The cursors move in place too (cursors of dropped rings stay, unused)
+  void Collect(Internal::ReportData& data, Parameter::Breakdown breakdown = Parameter::Merged, bool restart = true) {
+    const Cycles now = Intrinsic::RDTSC();
+    Internal::CollectLive(data, breakdown, &cursors, restart ? &cursors : nullptr);
+    data.interval_ns = (double)(now - begin_tsc) / data.cycles_per_ns;
+    if (restart) begin_tsc = now;
+  }
+
+  void Write(std::ostream& oss, const ReportOptions& opt, bool restart = true) {
+    if (opt.unit == Parameter::Time || opt.data == Parameter::Calibrated) Manager::Get().EnsureCalibrated();
+    Internal::ReportData& data = Internal::ReportDataScratch();
+    Collect(data, opt.breakdown, restart);
+    Internal::WriteReport(oss, data, opt);
+  }
+
+private:
+  Internal::Cursors cursors;
+  Cycles begin_tsc = 0;
+};
+
+namespace Internal {
+inline Interval& DefaultInterval(std::mutex*& m) {
+  static std::mutex mutex;
+  static Interval interval;
+  m = &mutex;
+  return interval;
 }
+    }
 
-inline void DumpToStream(std::ostream& oss, Parameter::Unit unit = Parameter::Cycle, Parameter::Data data_mode = Parameter::Raw) {
-  Manager& mgr = Manager::Get();
-  if (unit == Parameter::Time || data_mode == Parameter::Calibrated) {
+// Process-wide window: BeginInterval discards what was recorded so far from the next report,
+// EndInterval reports the window and starts the next one at the same cut (call it every second for per-second reports)
+inline void BeginInterval() {
+  std::mutex* m;
+  Interval& i = Internal::DefaultInterval(m);
+  std::lock_guard<std::mutex> lock(*m);
+  i.Begin();
+}
+
+inline void EndInterval(std::ostream& oss, const ReportOptions& opt = ReportOptions()) {
+  std::mutex* m;
+  Interval& i = Internal::DefaultInterval(m);
+  std::lock_guard<std::mutex> lock(*m);
+  i.Write(oss, opt);
+}
+
+
+
+// ---------------------------------------------------------------------------------------------
+// Binary trace file: raw samples with calibration, no per-sample formatting on the recording box
+//
+//   TraceHeader | calib_offsets[calib_count] | { TraceBlock | Cycles[count] }* | ID table
+//   ID table: id_count x { uint32 length | bytes }
+// All fields native-endian (x86_64); header is patched with counts and table offset on Close
+// ---------------------------------------------------------------------------------------------
+namespace Internal {
+inline constexpr char TRACE_MAGIC[8] = {'L', 'A', 'T', 'T', 'E', 'T', 'R', 'C'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t calib_count;
+  double cycles_per_ns;
+  uint64_t table_offset;
+  uint64_t block_count;
+  uint32_t id_count;
+  uint32_t thread_count;
+};
+
+struct TraceBlock {
+  uint32_t thread;
+  uint32_t id;
+  uint8_t calib_key;
+  uint8_t pad[7];
+  uint64_t first_seq;
+  uint64_t count;
+  uint64_t lost;
+};
+
+static_assert(sizeof(TraceHeader) % 8 == 0 && sizeof(TraceBlock) % 8 == 0, "samples must stay 8-byte aligned");
+    }
+
+// Streams ring contents to a trace file. Usable standalone (AppendLive) or as a drain sink (Sink)
+class TraceWriter {
+public:
+  TraceWriter() = default;
+  explicit TraceWriter(const char* path) { Open(path); }
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+  ~TraceWriter() { Close(); }
+
+  bool Open(const char* path) {
+    Close();
+#if defined(__linux__)
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+#else
+    file = std::fopen(path, "wb");
+    if (!file) return false;
+#endif
+    Manager& mgr = Manager::Get();
     mgr.EnsureCalibrated();
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Internal::TRACE_MAGIC, sizeof(header.magic));
+    header.version = Internal::TRACE_VERSION;
+    header.calib_count = (uint32_t)Internal::CALIB_KEY_COUNT;
+    header.cycles_per_ns = mgr.cycles_per_ns;
+    for (size_t k = 0; k < Internal::CALIB_KEY_COUNT; ++k) offsets[k] = mgr.CalibrationOffset((uint8_t)k);
+
+    offset = 0;
+    ok = true;
+    Write({{&header, sizeof(header)}, {offsets.data(), sizeof(offsets)}});
+    return ok;
   }
 
-  struct Series {
-    std::vector<double> values;
-    uint8_t calib_key = Internal::CALIB_KEY_UNSET;
-  };
+  bool IsOpen() const {
+#if defined(__linux__)
+    return fd >= 0;
+#else
+    return file != nullptr;
+#endif
+  }
+
+  // One block per batch; samples are written straight from the batch memory
+  void Append(const DrainBatch& b) {
+    if (!IsOpen() || (b.count == 0 && b.lost == 0)) return;
+    Internal::TraceBlock block = MakeBlock(b.thread, b.id, b.calib_key, b.first_seq, b.count, b.lost);
+    Write({{&block, sizeof(block)}, {b.samples, b.count * sizeof(Cycles)}});
+  }
 
-  std::map<ID, Series> global_data;
+  DrainSink Sink() { return [this](const DrainBatch& b) { Append(b); }; }
 
-  { // Thread-safe data collection
-    std::lock_guard<std::mutex> lock(mgr.mutex);
-    for (auto* ts : mgr.thread_buffers) {
-      for (auto& [id, buffer] : ts->history) {
-        Series& s = global_data[id];
+  // Snapshot of every live ring (lock-free per ring), written with as few syscalls as possible
+  void AppendLive() {
+    if (!IsOpen()) return;
+    Manager& mgr = Manager::Get();
+    std::vector<Cycles> samples;
+    std::vector<Internal::TraceBlock> blocks;
+    std::vector<size_t> starts;
+    {
+      std::lock_guard<std::mutex> lock(mgr.mutex);
+      for (auto* ts : mgr.thread_buffers) {
+        std::lock_guard<std::mutex> ts_lock(ts->mutex);
+        for (auto& [id, buffer] : ts->history) {
+          const size_t start = samples.size();
+          const RingBuffer::Window w = buffer.Read(samples);
+          if (w.size() == 0) continue;
+          blocks.push_back(MakeBlock(ts, id, buffer.calib_key.load(std::memory_order_relaxed), w.begin, w.size(), 0));
+          starts.push_back(start);
+        }
+      }
+    }
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(blocks.size() * 2);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      chunks.push_back({&blocks[i], sizeof(Internal::TraceBlock)});
+      chunks.push_back({samples.data() + starts[i], (size_t)blocks[i].count * sizeof(Cycles)});
+    }
+    Write(chunks);
+  }
+
+  // Writes the ID table and patches the header. Returns false if any write failed
+  bool Close() {
+    if (!IsOpen()) return ok;
+    std::vector<uint32_t> lengths(id_order.size());
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < id_order.size(); ++i) {
+      const char* name = id_order[i] ? id_order[i] : "<null-id>";
+      lengths[i] = (uint32_t)std::strlen(name);
+      chunks.push_back({&lengths[i], sizeof(uint32_t)});
+      chunks.push_back({name, lengths[i]});
+    }
+    header.table_offset = offset;
+    Write(chunks);
+
+    header.id_count = (uint32_t)id_order.size();
+    header.thread_count = (uint32_t)threads.size();
+#if defined(__linux__)
+    if (::pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) ok = false;
+    ::close(fd);
+    fd = -1;
+#else
+    std::fseek(file, 0, SEEK_SET);
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) ok = false;
+    std::fclose(file);
+    file = nullptr;
+#endif
+    ids.clear();
+    id_order.clear();
+    threads.clear();
+    return ok;
+  }
 
-        if (s.calib_key == Internal::CALIB_KEY_UNSET) s.calib_key = buffer.calib_key;
-        else if (s.calib_key != buffer.calib_key)      s.calib_key = Internal::CALIB_KEY_MIXED;
+private:
+  struct Chunk { const void* base; size_t len; };
+
+#if defined(__linux__)
+  int fd = -1;
+#else
+  std::FILE* file = nullptr;
+#endif
+  bool ok = true;
+  uint64_t offset = 0;
+  Internal::TraceHeader header{};
+  std::array<Cycles, Internal::CALIB_KEY_COUNT> offsets{};
+  std::map<ID, uint32_t> ids;
+  std::vector<ID> id_order;
+  std::map<const ThreadStorage*, uint32_t> threads;
 
-        for (size_t i = 0; i < MAX_SAMPLES; ++i) {
-          if (buffer.data[i] > 0) s.values.push_back((double)buffer.data[i]);
+  Internal::TraceBlock MakeBlock(const ThreadStorage* ts, ID id, uint8_t key, uint64_t first, uint64_t count, uint64_t lost) {
+    Internal::TraceBlock block{};
+    block.thread = threads.emplace(ts, (uint32_t)threads.size()).first->second;
+    auto it = ids.find(id);
+    if (it == ids.end()) {
+      it = ids.emplace(id, (uint32_t)id_order.size()).first;
+      id_order.push_back(id);
+    }
+    block.id = it->second;
+    block.calib_key = key;
+    block.first_seq = first;
+    block.count = count;
+    block.lost = lost;
+    header.block_count++;
+    return block;
+  }
+
+  void Write(const std::vector<Chunk>& chunks) {
+#if defined(__linux__)
+    std::vector<iovec> iov;
+    iov.reserve(std::min<size_t>(chunks.size(), IOV_MAX));
+    for (size_t i = 0; i < chunks.size();) {
+      iov.clear();
+      size_t bytes = 0;
+      for (; i < chunks.size() && iov.size() < (size_t)IOV_MAX; ++i) {
+        if (chunks[i].len == 0) continue;
+        iov.push_back(iovec{const_cast<void*>(chunks[i].base), chunks[i].len});
+        bytes += chunks[i].len;
+      }
+      size_t done = 0, first = 0;
+      while (done < bytes) { // resume after partial writes
+        const ssize_t n = ::writev(fd, iov.data() + first, (int)(iov.size() - first));
+        if (n <= 0) { ok = false; return; }
+        done += (size_t)n;
+        size_t adv = (size_t)n;
+        while (first < iov.size() && adv >= iov[first].iov_len) adv -= iov[first++].iov_len;
+        if (first < iov.size()) {
+          iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + adv;
+          iov[first].iov_len -= adv;
         }
       }
+      offset += bytes;
     }
+#else
+    for (const Chunk& c : chunks) {
+      if (c.len && std::fwrite(c.base, 1, c.len, file) != c.len) ok = false;
+      offset += c.len;
+    }
+#endif
   }
+};
 
-  auto FormatLarge = [](double val) {
-    const char* units[] = {"", "K", "M", "B", "T"};
-    int unit_idx = 0;
-    while (val >= 1000.0 && unit_idx < 4) { val /= 1000.0; unit_idx++; }
-    std::ostringstream ss;
-    if (unit_idx == 0) ss << std::fixed << std::setprecision(0) << val;
-    else ss << std::fixed << std::setprecision(2) << val << " " << units[unit_idx];
-    return ss.str();
-  };
+inline bool WriteTrace(const char* path) {
+  TraceWriter writer;
+  if (!writer.Open(path)) return false;
+  writer.AppendLive();
+  return writer.Close();
+}
 
-  auto ToDisp = [&](double cycles) {
-    return (unit == Parameter::Time) ? FormatTime(cycles / mgr.cycles_per_ns) : FormatLarge(cycles);
+// Read-only view of a trace file (memory-mapped; block samples point into the mapping)
+class Trace {
+public:
+  struct Block {
+    uint32_t thread;
+    uint32_t id;
+    uint8_t calib_key;
+    uint64_t first_seq;
+    uint64_t lost;
+    const Cycles* samples;
+    size_t count;
   };
 
-  // Column Widths
-  const int C1 = 20;
-  const int C2 = 9;
-  const int C3 = 10;
-  const int C4 = 10;
-  const int C5 = 10;
-  const int C6 = 8;
-  const int C7 = 10;
-  const int C8 = 10;
-  const int C9 = 10;
-  const int C_BY = 10;
+  double cycles_per_ns = 1.0;
+  std::vector<Cycles> calib_offsets;
+  std::vector<std::string> ids;
+  std::vector<Block> blocks;
+  uint32_t thread_count = 0;
 
-  const int COL_COUNT=10;
-  const int TABLE_WIDTH = C1 + C2 + C3 + C4 + C5 + C6 + C7 + C8 + C9 + C_BY + (3*(COL_COUNT-1)+2);
-  const std::string line(TABLE_WIDTH, '-');
-  const std::string d_line(TABLE_WIDTH, '=');
+  Trace() = default;
+  Trace(const Trace&) = delete;
+  Trace& operator=(const Trace&) = delete;
+  ~Trace() { Unmap(); }
 
-  const char* LIGHT_GRAY = "\033[90m";
-  const char* COLOR_RESET = "\033[0m";
-  auto gray = [&](const std::string& s) {
-    return std::string(LIGHT_GRAY) + s + COLOR_RESET;
-  };
+  bool Open(const char* path) {
+    Unmap();
+    calib_offsets.clear();
+    ids.clear();
+    blocks.clear();
+#if defined(__linux__)
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Internal::TraceHeader)) { ::close(fd); return false; }
+    size = (size_t)st.st_size;
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { size = 0; return false; }
+    base = static_cast<const char*>(p);
+#else
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    std::fseek(f, 0, SEEK_END);
+    copy.resize((size_t)std::ftell(f));
+    std::fseek(f, 0, SEEK_SET);
+    const bool read_ok = std::fread(copy.data(), 1, copy.size(), f) == copy.size();
+    std::fclose(f);
+    if (!read_ok) return false;
+    base = copy.data();
+    size = copy.size();
+#endif
+    return Parse();
+  }
+
+private:
+  const char* base = nullptr;
+  size_t size = 0;
+#if !defined(__linux__)
+  std::vector<char> copy;
+#endif
+
+  bool Parse() {
+    Internal::TraceHeader h;
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, Internal::TRACE_MAGIC, sizeof(h.magic)) != 0 || h.version != Internal::TRACE_VERSION) return false;
+
+    size_t pos = sizeof(h);
+    if (pos + (size_t)h.calib_count * sizeof(Cycles) > size) return false;
+    calib_offsets.resize(h.calib_count);
+    std::memcpy(calib_offsets.data(), base + pos, h.calib_count * sizeof(Cycles));
+    pos += h.calib_count * sizeof(Cycles);
 
-  auto write_row = [&](const std::vector<std::string>& cells) {
-    oss << gray("|") << " ";
-    for (size_t i = 0; i < cells.size(); ++i) {
-      if (i > 0) oss << gray(" | ");
-      oss << cells[i];
+    cycles_per_ns = h.cycles_per_ns;
+    thread_count = h.thread_count;
+    if (h.table_offset > size) return false;
+
+    blocks.reserve((size_t)h.block_count);
+    for (uint64_t i = 0; i < h.block_count; ++i) {
+      if (pos + sizeof(Internal::TraceBlock) > h.table_offset) return false;
+      Internal::TraceBlock b;
+      std::memcpy(&b, base + pos, sizeof(b));
+      pos += sizeof(b);
+      if (b.count > (h.table_offset - pos) / sizeof(Cycles)) return false;
+      blocks.push_back(Block{b.thread, b.id, b.calib_key, b.first_seq, b.lost,
+                             reinterpret_cast<const Cycles*>(base + pos), (size_t)b.count});
+      pos += (size_t)b.count * sizeof(Cycles);
     }
-    oss << " " << gray("|") << "\n";
-  };
-  auto col = [](const std::string& s, int width, bool left = false) {
-    std::ostringstream ss;
-    if (left) ss << std::left  << std::setw(width) << s;
-    else      ss << std::right << std::setw(width) << s;
-    std::string res = ss.str();
-    return (res.size() > (size_t)width) ? res.substr(0, width) : res;
-  };
 
-  oss << "\n" << gray("#") << gray(d_line) << gray("#") << "\n";
-  std::string title = "LATTE TELEMETRY [" + std::string((unit == Parameter::Time) ? "TIME" : "CYCLES") + "][" + std::string((data_mode == Parameter::Calibrated) ? "CAL" : "RAW") + "]";
-  write_row({col(title, TABLE_WIDTH - 2, true)});
-  oss << gray("#") << gray(d_line) << gray("#") << "\n";
+    pos = (size_t)h.table_offset;
+    ids.reserve(h.id_count);
+    for (uint32_t i = 0; i < h.id_count; ++i) {
+      uint32_t len;
+      if (pos + sizeof(len) > size) return false;
+      std::memcpy(&len, base + pos, sizeof(len));
+      pos += sizeof(len);
+      if (pos + len > size) return false;
+      ids.emplace_back(base + pos, len);
+      pos += len;
+    }
+    for (const Block& b : blocks) {
+      if (b.id >= ids.size()) return false;
+    }
+    return true;
+  }
 
+  void Unmap() {
+#if defined(__linux__)
+    if (base) ::munmap(const_cast<char*>(base), size);
+#else
+    copy.clear();
+#endif
+    base = nullptr;
+    size = 0;
+  }
+};
 
-  // Removing overhead measured by your Latte-calls themself (noise)
-  if (data_mode == Parameter::Calibrated) {
-    auto off_str = [&](uint8_t sm, uint8_t em) -> std::string {
-      const uint8_t k = Internal::CalibKey(sm, em);
-      return ToDisp((double)mgr.CalibrationOffset(k));
-    };
+namespace Internal {
+// IDs point into trace.ids: the trace must outlive the returned data
+// Trace files keep per-thread blocks but no TSC_AUX: PerCore falls back to Merged
+inline ReportData CollectTrace(const Trace& trace, Parameter::Breakdown breakdown = Parameter::Merged) {
+  ReportData data;
+  data.cycles_per_ns = trace.cycles_per_ns;
+  for (size_t k = 0; k < CALIB_KEY_COUNT && k < trace.calib_offsets.size(); ++k) data.calib_offsets[k] = trace.calib_offsets[k];
 
-    auto off_pulse_str = [&]() -> std::string {
-      return ToDisp((double)mgr.CalibrationOffset(Internal::CALIB_KEY_PULSE));
-    };
+  for (const Trace::Block& b : trace.blocks) {
+    Series& s = data.series[trace.ids[b.id].c_str()];
+    s.MergeKey(b.calib_key);
+    if (b.calib_key == CALIB_KEY_PULSE && b.count) data.pulses[trace.ids[b.id].c_str()].push_back(PulseRun{s.values.size(), b.count});
+    s.values.insert(s.values.end(), b.samples, b.samples + b.count);
+    if (breakdown == Parameter::PerThread) {
+      Series& part = data.parts[trace.ids[b.id].c_str()][b.thread];
+      part.MergeKey(b.calib_key);
+      part.values.insert(part.values.end(), b.samples, b.samples + b.count);
+      data.part_labels.emplace(b.thread, Text("T").Int(b.thread));
+    }
+  }
+  return data;
+}
+    }
 
-    constexpr int MW = 14;
-    auto mcol = [&](const std::string& s, int w, bool left = false) {
-      std::ostringstream ss;
-      if (left) ss << std::left  << std::setw(w) << s;
-      else      ss << std::right << std::setw(w) << s;
-      std::string res = ss.str();
-      return (res.size() > (size_t)w) ? res.substr(0, w) : res;
-    };
+// Same report as the live DumpToStream, computed offline from a trace file
+inline void DumpToStream(std::ostream& oss, const Trace& trace, const ReportOptions& opt) {
+  Internal::WriteReport(oss, Internal::CollectTrace(trace, opt.breakdown), opt);
+}
 
-    const auto F = (uint8_t)Mode::Fast;
-    const auto M = (uint8_t)Mode::Mid;
-    const auto H = (uint8_t)Mode::Hard;
-
-    const std::string END(82, ' ');
-
-    write_row({col("OVERHEAD H[Start] x W[Stop]", TABLE_WIDTH - 2, true)});
-    write_row({mcol("", 10, true) + mcol("F", MW) + mcol("M", MW) + mcol("H", MW) + END});
-    write_row({mcol("F", 10, true) + mcol(off_str(F, F), MW) + mcol(off_str(F, M), MW) + mcol(off_str(F, H), MW) + END});
-    write_row({mcol("M", 10, true) + mcol(off_str(M, F), MW) + mcol(off_str(M, M), MW) + mcol(off_str(M, H), MW) + END});
-    write_row({mcol("H", 10, true) + mcol(off_str(H, F), MW) + mcol(off_str(H, M), MW) + mcol(off_str(H, H), MW) + END});
-    write_row({mcol("PULSE", 10, true) + mcol(off_pulse_str(), MW) + mcol("", MW) + mcol("", MW) + END});
-    oss << gray("|") << gray(line) << gray("|") << "\n";
-  }
-  write_row({
-    col("COMPONENT", C1, true),
-    col("SAMPLES", C2),
-    col("AVG", C3),
-    col("MEDIAN", C4),
-    col("STD DEV", C5),
-    col("SKEW", C6),
-    col("MIN", C7),
-    col("MAX", C8),
-    col("RANGE", C9),
-    col("BYPASS", C_BY)
-  });
+inline void DumpToStream(std::ostream& oss, const Trace& trace, Parameter::Unit unit = Parameter::Cycle, Parameter::Data data_mode = Parameter::Raw) {
+  ReportOptions opt;
+  opt.unit = unit;
+  opt.data = data_mode;
+  DumpToStream(oss, trace, opt);
+}
 
-  oss << gray("|") << gray(line) << gray("|") << "\n";
-  for (auto& [id, series] : global_data) {
-    if (series.values.empty()) continue;
 
+// Timeline export of Latte::Event samples as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// One track per registered thread; ts/dur in microseconds from the earliest retained event
+inline void ExportChromeTrace(std::ostream& oss, Parameter::Data data_mode = Parameter::Calibrated) {
+  Manager& mgr = Manager::Get();
+  mgr.EnsureCalibrated();
 
-    std::vector<double> adjusted; // noise removal
-    adjusted.reserve(series.values.size());
+  struct Track {
+    std::vector<Cycles> starts, durations;
+    std::vector<uint32_t> ids;
+    std::vector<uint8_t> depths, keys;
+  };
+  std::vector<Track> tracks;
+  {
+    std::lock_guard<std::mutex> lock(mgr.mutex);
+    tracks.resize(mgr.thread_buffers.size());
+    for (size_t t = 0; t < mgr.thread_buffers.size(); ++t) {
+      ThreadStorage* ts = mgr.thread_buffers[t];
+      std::lock_guard<std::mutex> ts_lock(ts->mutex);
+      if (EventBuffer* e = ts->events.load(std::memory_order_acquire)) {
+        Track& k = tracks[t];
+        e->Read(k.starts, k.durations, k.ids, k.depths, k.keys);
+      }
+    }
+  }
 
-    const double off = (data_mode == Parameter::Calibrated) ? (double)mgr.CalibrationOffset(series.calib_key) : 0.0;
+  Cycles t0 = std::numeric_limits<Cycles>::max();
+  for (const Track& k : tracks) {
+    for (Cycles c : k.starts) t0 = std::min(t0, c);
+  }
 
-    for (double v : series.values) {
-      double x = v - off;
-      if (x < 0.0) x = 0.0;
-      adjusted.push_back(x);
+  auto escape = [](ID name) {
+    std::string out;
+    for (const char* c = name ? name : "<unregistered>"; *c; ++c) {
+      if (*c == '"' || *c == '\\') out += '\\';
+      if ((unsigned char)*c < 0x20) continue;
+      out += *c;
     }
+    return out;
+  };
 
-    // user-extracted cleaning function
-    Internal::CleanResult clean = Internal::CleanData(adjusted);
-    std::vector<double>& clean_values = clean.values;
-    size_t cpu_bypass_count = clean.bypass;
+  std::map<uint32_t, std::string> names;
+  Internal::Registry& reg = Internal::Registry::Get();
+  const double us_per_cycle = 1.0 / (mgr.cycles_per_ns * 1e3);
 
-    const size_t n = clean_values.size();
-    if (n == 0) continue;
+  oss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  oss << std::fixed << std::setprecision(3);
+  for (size_t t = 0; t < tracks.size(); ++t) {
+    const Track& k = tracks[t];
+    if (k.starts.empty()) continue;
+    oss << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+        << ",\"args\":{\"name\":\"latte-" << t << "\"}}";
+    first = false;
 
-    double sum = 0;
-    for (double v : clean_values) sum += v;
-    const double avg = sum / (double)n;
-    const double median = Internal::MedianFromSorted(clean_values);
+    for (size_t i = 0; i < k.starts.size(); ++i) {
+      auto it = names.find(k.ids[i]);
+      if (it == names.end()) it = names.emplace(k.ids[i], escape(reg.Name(k.ids[i]))).first;
+
+      Cycles dur = k.durations[i];
+      if (data_mode == Parameter::Calibrated) {
+        const Cycles off = mgr.CalibrationOffset(k.keys[i]);
+        dur = (dur > off) ? dur - off : 0;
+      }
+      oss << ",\n{\"name\":\"" << it->second << "\",\"cat\":\"latte\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+          << ",\"ts\":" << (double)(k.starts[i] - t0) * us_per_cycle
+          << ",\"dur\":" << (double)dur * us_per_cycle
+          << ",\"args\":{\"depth\":" << (unsigned)k.depths[i] << "}}";
+    }
+  }
+  oss << "\n]}\n";
+}
 
-    double var_sum = 0, skew_sum = 0;
-    for (double v : clean_values) {
-      double d = v - avg;
-      var_sum += d * d;
-      skew_sum += (d * d * d);
+// ---------------------------------------------------------------------------------------------
+// Live metrics export: a background thread publishes rolling-window stats per ID into a POSIX
+// shared-memory segment that an external monitor can scrape (see ReadExport, tools/latte_top.cpp).
+// Recording threads are untouched: rings are read with RingBuffer::Read and per-buffer cursors
+//
+//   ExportHeader | ExportRow[capacity]
+// The table is guarded by a seqlock on ExportHeader::sequence (odd while the exporter writes)
+// ---------------------------------------------------------------------------------------------
+namespace Internal {
+inline constexpr char EXPORT_MAGIC[8] = {'L', 'A', 'T', 'T', 'E', 'E', 'X', 'P'};
+constexpr uint32_t EXPORT_VERSION = 1;
     }
 
-    const double std_dev = std::sqrt(var_sum / (double)n);
-    const double skew = (n > 1 && std_dev > 1e-9) ? (skew_sum / (double)n) / (std_dev * std_dev * std_dev) : 0.0;
+// One ID over the rolling window; times in ns (calibrated with ExportOptions::data), value probes raw
+struct ExportRow {
+  char name[48];         // ID text, truncated
+  uint64_t count;        // samples in the window (after cleaning)
+  uint64_t total;        // samples harvested since the exporter started
+  uint64_t lost;         // overwritten before the exporter read them
+  double avg, std_dev, min, max;
+  double p50, p90, p99, p999;
+};
+
+struct ExportHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t capacity;              // rows allocated after the header
+  std::atomic<uint64_t> sequence; // seqlock: odd while the table is written
+  uint64_t rows;                  // rows in use; row index of an ID never changes
+  uint64_t updated_ns;            // wall clock (ns since epoch) of the last publish
+  uint64_t window_ns;
+  double cycles_per_ns;
+};
 
-    std::ostringstream sk;
-    sk << std::fixed << std::setprecision(2) << skew;
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock counter lives in shared memory");
 
-    const std::string component_name = (id !=nullptr) ? std::string(id) : std::string("<null-id>");
+struct ExportOptions {
+  std::string name = "/latte";                     // shm_open name
+  std::chrono::milliseconds period{1000};          // publish interval
+  std::chrono::milliseconds window{10000};         // rolling window, rounded up to whole periods
+  uint32_t capacity = 1024;                        // IDs beyond this are not exported
+  Parameter::Data data = Parameter::Calibrated;
+};
 
-    write_row({
-      col(component_name, C1, true),
-      col(std::to_string(n), C2),
-      col(ToDisp(avg), C3),
-      col(ToDisp(median), C4),
-      col(ToDisp(std_dev), C5),
-      col(sk.str(), C6),
-      col(ToDisp(clean_values.front()), C7),
-      col(ToDisp(clean_values.back()), C8),
-      col(ToDisp(clean_values.back() - clean_values.front()), C9),
-      col(std::to_string(cpu_bypass_count), C_BY)
+class Exporter {
+public:
+  Exporter() = default;
+  explicit Exporter(const ExportOptions& opt) { Start(opt); }
+  Exporter(const Exporter&) = delete;
+  Exporter& operator=(const Exporter&) = delete;
+  ~Exporter() { Stop(); }
+
+  // Creates the segment and the publisher thread. Samples already in the rings are skipped
+  bool Start(const ExportOptions& opt) {
+    Stop();
+#if defined(__linux__)
+    options = opt;
+    options.capacity = std::max<uint32_t>(1, options.capacity);
+    const size_t size = sizeof(ExportHeader) + sizeof(ExportRow) * options.capacity;
+    const int fd = shm_open(options.name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    void* p = (ftruncate(fd, (off_t)size) == 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      shm_unlink(options.name.c_str());
+      return false;
+    }
+    mapping = p;
+    mapping_size = size;
+    std::memset(p, 0, size);
+    header = new (p) ExportHeader();
+    rows = reinterpret_cast<ExportRow*>(header + 1);
+    std::memcpy(header->magic, Internal::EXPORT_MAGIC, sizeof(header->magic));
+    header->version = Internal::EXPORT_VERSION;
+    header->capacity = options.capacity;
+
+    Manager& mgr = Manager::Get();
+    if (options.data == Parameter::Calibrated) mgr.EnsureCalibrated();
+    const long long period_ms = std::max<long long>(1, options.period.count());
+    slices = (size_t)std::max<long long>(1, (options.window.count() + period_ms - 1) / period_ms);
+    header->window_ns = (uint64_t)(slices * period_ms) * 1000000ull;
+    header->cycles_per_ns = mgr.cycles_per_ns;
+    Harvest(false);
+
+    running = true;
+    thread = std::thread([this]() {
+      std::unique_lock<std::mutex> lock(thread_mutex);
+      while (running) {
+        cv.wait_for(lock, options.period, [this]() { return !running; });
+        if (!running) break;
+        lock.unlock();
+        PublishOnce();
+        lock.lock();
+      }
     });
+    return true;
+#else
+    (void)opt;
+    return false;
+#endif
+  }
+
+  // Stops the publisher and removes the segment (readers that still map it keep the last table)
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(thread_mutex);
+      running = false;
+    }
+    cv.notify_all();
+    if (thread.joinable()) thread.join();
+#if defined(__linux__)
+    if (mapping) {
+      munmap(mapping, mapping_size);
+      shm_unlink(options.name.c_str());
+    }
+#endif
+    mapping = nullptr;
+    header = nullptr;
+    rows = nullptr;
+    cursors.clear();
+    windows.clear();
   }
 
-  oss << "#" << d_line << "#" << std::endl;
+  // One harvest + publish pass (also callable without the thread, e.g. from an existing event loop)
+  void PublishOnce() {
+    std::lock_guard<std::mutex> pass(pass_mutex);
+    if (!header) return;
+    Harvest(true);
 
-}
+    Manager& mgr = Manager::Get();
+    const double cycles_ns = mgr.cycles_per_ns;
+    static const std::vector<double> pcts = {90.0, 99.0, 99.9};
+    std::vector<ExportRow> table(windows.size());
+    size_t used = 0;
+    for (auto& [id, w] : windows) {
+      if (w.row >= options.capacity) continue;
+      Internal::Series series;
+      series.calib_key = w.calib_key;
+      for (const std::vector<Cycles>& s : w.slices) series.values.insert(series.values.end(), s.begin(), s.end());
+      const bool value = (w.calib_key == Internal::CALIB_KEY_VALUE);
+      const Cycles off = (options.data == Parameter::Calibrated) ? mgr.CalibrationOffset(w.calib_key) : 0;
+      const Internal::Stats st = Internal::ComputeStats(series, off, pcts, !value);
+      const double cpns = value ? 1.0 : cycles_ns; // value probes are exported raw
+
+      ExportRow& r = table[w.row];
+      std::strncpy(r.name, id ? id : "<unregistered>", sizeof(r.name) - 1);
+      r.count = st.n;
+      r.total = w.total;
+      r.lost = w.lost;
+      if (st.n) {
+        r.avg = st.avg / cpns;
+        r.std_dev = st.std_dev / cpns;
+        r.min = st.min / cpns;
+        r.max = st.max / cpns;
+        r.p50 = st.median / cpns;
+        r.p90 = st.percentiles[0] / cpns;
+        r.p99 = st.percentiles[1] / cpns;
+        r.p999 = st.percentiles[2] / cpns;
+      }
+      used = std::max<size_t>(used, w.row + 1);
+    }
+
+    const uint64_t seq = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(rows, table.data(), used * sizeof(ExportRow));
+    header->rows = used;
+    header->cycles_per_ns = cycles_ns;
+    header->updated_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header->sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  bool Running() const { return header != nullptr; }
+
+private:
+  struct Window {
+    uint32_t row = 0;
+    uint8_t calib_key = Internal::CALIB_KEY_UNSET;
+    std::deque<std::vector<Cycles>> slices; // one per period, newest at the back
+    uint64_t total = 0;
+    uint64_t lost = 0;
+  };
+
+  ExportOptions options;
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+  ExportHeader* header = nullptr;
+  ExportRow* rows = nullptr;
+  size_t slices = 1;
 
+  std::mutex thread_mutex;
+  std::mutex pass_mutex;
+  std::condition_variable cv;
+  std::thread thread;
+  bool running = false;
+
+  Internal::Cursors cursors;
+  std::map<ID, Window> windows;
+
+  // Appends one slice per ID with the samples written since the last pass (keep=false only moves the cursors)
+  void Harvest(bool keep) {
+    Manager& mgr = Manager::Get();
+    std::vector<Cycles> scratch;
+    std::map<ID, std::vector<Cycles>> fresh;
+    Internal::Cursors next; // rebuilt each pass: forgets dropped buffers
+    {
+      std::lock_guard<std::mutex> lock(mgr.mutex);
+      for (auto* ts : mgr.thread_buffers) {
+        std::lock_guard<std::mutex> ts_lock(ts->mutex);
+        for (auto& [id, buffer] : ts->history) {
+          const uint64_t from = Internal::CursorFrom(cursors, ts, id, buffer);
+          scratch.clear();
+          const RingBuffer::Window rw = buffer.Read(scratch, from);
+          next[{ts, id}] = Internal::RingCursor{buffer.generation, rw.end};
+          if (!keep) continue;
+
+          auto w = windows.find(id);
+          if (w == windows.end()) {
+            w = windows.emplace(id, Window{}).first;
+            w->second.row = (uint32_t)(windows.size() - 1);
+          }
+          const uint8_t key = buffer.calib_key.load(std::memory_order_relaxed);
+          if (w->second.calib_key == Internal::CALIB_KEY_UNSET) w->second.calib_key = key;
+          else if (w->second.calib_key != key) w->second.calib_key = Internal::CALIB_KEY_MIXED;
+          w->second.total += rw.size();
+          w->second.lost += (rw.begin > from) ? rw.begin - from : 0;
+          std::vector<Cycles>& f = fresh[id];
+          f.insert(f.end(), scratch.begin(), scratch.end());
+        }
+      }
+    }
+    cursors.swap(next);
+    if (!keep) return;
+
+    for (auto& [id, w] : windows) {
+      auto f = fresh.find(id);
+      w.slices.push_back(f != fresh.end() ? std::move(f->second) : std::vector<Cycles>());
+      while (w.slices.size() > slices) w.slices.pop_front();
+    }
+  }
+};
+
+// Consistent copy of an export table (seqlock retry). For monitors in other processes; no writer-side locks
+inline bool ReadExport(const char* name, ExportHeader& header_out, std::vector<ExportRow>& rows_out) {
+#if defined(__linux__)
+  const int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  void* p = (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ExportHeader))
+                ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (p == MAP_FAILED) return false;
+  const size_t size = (size_t)st.st_size;
+  const ExportHeader* h = static_cast<const ExportHeader*>(p);
+  const ExportRow* r = reinterpret_cast<const ExportRow*>(h + 1);
+  bool ok = std::memcmp(h->magic, Internal::EXPORT_MAGIC, sizeof(h->magic)) == 0 && h->version == Internal::EXPORT_VERSION &&
+            sizeof(ExportHeader) + sizeof(ExportRow) * (size_t)h->capacity <= size;
+  for (int attempt = 0; ok; ++attempt) {
+    const uint64_t s1 = h->sequence.load(std::memory_order_acquire);
+    if (!(s1 & 1)) {
+      const size_t n = (size_t)std::min<uint64_t>(h->rows, h->capacity);
+      std::memcpy(static_cast<void*>(&header_out), h, sizeof(ExportHeader));
+      rows_out.resize(n);
+      if (n) std::memcpy(rows_out.data(), r, n * sizeof(ExportRow));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (h->sequence.load(std::memory_order_relaxed) == s1) break;
+    }
+    if (attempt > 1000) ok = false;
+    std::this_thread::yield();
+  }
+  munmap(p, size);
+  return ok;
+#else
+  (void)name; (void)header_out; (void)rows_out;
+  return false;
+#endif
+}
 
 }
 
 //once
 #define LATTE_CALIBRATE() do { Latte::Manager::Get().EnsureCalibrated(); } while(0)
+#define LATTE_CALIBRATE_ASYNC() do { Latte::Manager::Get().CalibrateAsync(); } while(0)
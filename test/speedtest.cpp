@@ -11,6 +11,10 @@
 #include <memory>
 #include <sstream>
 #include <chrono>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <fstream>
 
 #include "Latte.hpp"
 
@@ -46,8 +50,62 @@ constexpr int SAMPLES = 100;
 struct BenchResult {
     double avg, med, min, max, std_dev;
     std::string name;
+    std::string scenario = "core"; // machine-readable grouping
+    long param = 0;                // IDs / depth / threads, depending on scenario
+    double baseline = 0;
 };
 
+// Command line: --threads N --ids N --depth N --core N --format table|csv|json --out FILE
+struct Config {
+    int threads = 4;
+    int ids = 1024;
+    int depth = (int)Latte::MAX_ACTIVE_SLOTS;
+    int core = 3;
+    std::string format = "table";
+    std::string out;
+};
+
+static Config ParseArgs(int argc, char** argv) {
+    Config c;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if (k == "--threads") c.threads = std::max(1, std::atoi(v));
+        else if (k == "--ids") c.ids = std::max(1, std::atoi(v));
+        else if (k == "--depth") c.depth = std::clamp(std::atoi(v), 1, (int)Latte::MAX_ACTIVE_SLOTS);
+        else if (k == "--core") c.core = std::atoi(v);
+        else if (k == "--format") c.format = v;
+        else if (k == "--out") c.out = v;
+        else std::cerr << "Unknown option " << k << "\n";
+    }
+    return c;
+}
+
+static std::unique_ptr<BenchResult> Summarize(std::vector<double>& samples, const std::string& name) {
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    double sum = 0.0;
+    for (double v : samples) sum += v;
+    const double avg = sum / (double)n;
+    double var_sum = 0;
+    for (double v : samples) var_sum += (v - avg) * (v - avg);
+    return std::make_unique<BenchResult>(BenchResult{avg, samples[n / 2], samples[0], samples[n - 1], std::sqrt(var_sum / (double)n), name});
+}
+
+// Runtime-parameterized BENCHMARK: body(i) is timed `iterations` times per sample, result divided by `ops` per body
+template <typename F>
+static std::unique_ptr<BenchResult> Measure(const std::string& name, int iterations, int samples_n, double ops, F&& body) {
+    for (volatile int w = 0; w < iterations; w += 1) body(w);
+    std::vector<double> samples(samples_n);
+    for (int s = 0; s < samples_n; ++s) {
+        const uint64_t start = rdtsc_begin();
+        for (int i = 0; i < iterations; ++i) body(i);
+        const uint64_t end = rdtsc_end();
+        samples[s] = (double)(end - start) / iterations / ops;
+    }
+    return Summarize(samples, name);
+}
+
 #define BENCHMARK(NAME, CODE_BLOCK) \
     ([]() -> std::unique_ptr<BenchResult> { \
         auto samples_ptr = std::make_unique<double[]>(SAMPLES); \
@@ -85,7 +143,7 @@ struct BenchResult {
         return std::make_unique<BenchResult>(BenchResult{avg, med, min, max, std_dev, NAME}); \
     })()
 
-void PrintResult(const BenchResult& r, double baseline) {
+void PrintResult(const BenchResult& r, double baseline, std::ostream& os = std::cout) {
     // Pure Latency calculations (subtracting latency of ACTION(CODE_BLOCK -> TARGET_CODE))
     double adj_med = (r.med - baseline) > 0 ? (r.med - baseline) : 0.0;
     double adj_avg = (r.avg - baseline) > 0 ? (r.avg - baseline) : 0.0;
@@ -94,7 +152,7 @@ void PrintResult(const BenchResult& r, double baseline) {
 
     double delta  = r.max - r.min;
 
-    std::cout << "| " << std::left  << std::setw(23) << r.name
+    os << "| " << std::left  << std::setw(23) << r.name
               << " | " << std::right << std::fixed << std::setprecision(1) << std::setw(8) << r.med // Raw Total
               << " | " << "\033[1;34m" << std::setw(8) << adj_med << "\033[0m" // Cost (Blue)
               << " | " << std::setw(8) << adj_avg
@@ -105,22 +163,76 @@ void PrintResult(const BenchResult& r, double baseline) {
               << " |" << std::endl;
 }
 
-int main() {
-    PinThread(3);
+static const char* SEP = "+-------------------------+----------+----------+----------+----------+----------+----------+----------+";
+
+// Distinct ID pointers (pointer identity is the key, the text is only for the report)
+static std::vector<std::string>& IdNames(int n) {
+    static std::vector<std::string> names;
+    while ((int)names.size() < n) names.push_back("BenchId_" + std::to_string(names.size()));
+    return names;
+}
+
+static void WriteMachineReadable(std::ostream& os, const std::string& format, const std::vector<const BenchResult*>& rows) {
+    if (format == "csv") {
+        os << "scenario,name,param,total,cost,avg,min,max,std_dev\n";
+        for (const BenchResult* r : rows) {
+            os << r->scenario << ",\"" << r->name << "\"," << r->param << "," << r->med << "," << std::max(0.0, r->med - r->baseline)
+               << "," << r->avg << "," << r->min << "," << r->max << "," << r->std_dev << "\n";
+        }
+        return;
+    }
+    const char* p = "";
+    Latte::Manager& mgr = Latte::Manager::Get();
+    mgr.EnsureCalibrated();
+    os << "{\"cpu\":\"" << Latte::Internal::CpuBrand() << "\",\"cycles_per_ns\":" << mgr.cycles_per_ns
+       << ",\"tsc_source\":\"" << mgr.calibration_source << "\",\"unit\":\"cycles/op\",\"results\":[";
+    for (const BenchResult* r : rows) {
+        os << p << "\n  {\"scenario\":\"" << r->scenario << "\",\"name\":\"" << r->name << "\",\"param\":" << r->param
+           << ",\"total\":" << r->med << ",\"cost\":" << std::max(0.0, r->med - r->baseline) << ",\"avg\":" << r->avg
+           << ",\"min\":" << r->min << ",\"max\":" << r->max << ",\"std_dev\":" << r->std_dev << "}";
+        p = ",";
+    }
+    os << "\n]}\n";
+}
+
+int main(int argc, char** argv) {
+    const Config cfg = ParseArgs(argc, argv);
+    const bool table = (cfg.format == "table");
+    std::ostream null_stream(nullptr);
+    std::ostream& out = table ? std::cout : null_stream; // machine-readable formats print only the final document
+    PinThread(cfg.core);
+    std::vector<std::unique_ptr<BenchResult>> owned;
+    std::vector<const BenchResult*> rows; // emitted by --format csv|json
+    auto keep = [&](std::unique_ptr<BenchResult>& r, const char* scenario, long param, double baseline) {
+        r->scenario = scenario;
+        r->param = param;
+        r->baseline = baseline;
+        rows.push_back(r.get());
+        out << std::fixed << std::setprecision(2);
+        PrintResult(*r, baseline, out);
+    };
+    auto own = [&](std::unique_ptr<BenchResult> r, const char* scenario, long param, double baseline) {
+        owned.push_back(std::move(r));
+        keep(owned.back(), scenario, param, baseline);
+    };
 
-    std::cout << "+======================================================================================================+" << std::endl;
-    std::cout << "| LATTE LATENCY BENCHMARK (Cycles per Operation)                                                       |" << std::endl;
-    std::cout << "+======================================================================================================+" << std::endl;
+    out << "+======================================================================================================+" << std::endl;
+    out << "| LATTE LATENCY BENCHMARK (Cycles per Operation)                                                       |" << std::endl;
+    out << "+======================================================================================================+" << std::endl;
 
     auto r_baseline = BENCHMARK("Baseline (Empty Loop)", {
         asm volatile("");
     });
+    r_baseline->scenario = "core";
+    r_baseline->baseline = r_baseline->med;
+    rows.push_back(r_baseline.get());
+    const double base = r_baseline->med;
 
-    std::cout << "| Loop Overhead Baseline: \033[1;34m" << std::fixed << std::setprecision(2) << r_baseline->med << "\033[0m cycles/iter                                                             |" << std::endl;
-    std::cout << "+=========================+==========+==========+==========+==========+==========+==========+==========+" << std::endl;
+    out << "| Loop Overhead Baseline: \033[1;34m" << std::fixed << std::setprecision(2) << r_baseline->med << "\033[0m cycles/iter                                                             |" << std::endl;
+    out << "+=========================+==========+==========+==========+==========+==========+==========+==========+" << std::endl;
 
     // Table Header
-    std::cout << "| " << std::left  << std::setw(23) << "Benchmark Name"
+    out << "| " << std::left  << std::setw(23) << "Benchmark Name"
               << " | " << std::right << std::setw(8) << "Total"
               << " | " << std::right << std::setw(8) << "Cost"
               << " | " << std::right << std::setw(8) << "Avg"
@@ -129,17 +241,17 @@ int main() {
               << " | " << std::right << std::setw(8) << "StdDev"
               << " | " << std::right << std::setw(8) << "Delta"
               << " |" << std::endl;
-    std::cout << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+    out << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
 
 
     auto r_rdtsc = BENCHMARK("__rdtsc", { do_not_optimize(__rdtsc()); });
     auto r_rdtscp = BENCHMARK("__rdtscp", { unsigned int aux; do_not_optimize(__rdtscp(&aux)); });
     auto r_LFENCE = BENCHMARK("_LFENCE", { _mm_lfence(); });
 
-    PrintResult(*r_rdtsc, r_baseline->med);
-    PrintResult(*r_rdtscp, r_baseline->med);
-    PrintResult(*r_LFENCE, r_baseline->med);
-    std::cout << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+    keep(r_rdtsc, "core", 0, r_baseline->med);
+    keep(r_rdtscp, "core", 0, r_baseline->med);
+    keep(r_LFENCE, "core", 0, r_baseline->med);
+    out << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
 
 
     auto r_fast = BENCHMARK("Fast::Start + Stop", {
@@ -157,27 +269,162 @@ int main() {
         Latte::Hard::Stop(nullptr);
     });
 
-    PrintResult(*r_fast, r_baseline->med);
-    PrintResult(*r_mid, r_baseline->med);
-    PrintResult(*r_hard, r_baseline->med);
-    std::cout << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+    auto r_lean = BENCHMARK("Lean::Start + Stop", {
+        Latte::Lean::Start("BenchLean");
+        Latte::Lean::Stop(nullptr);
+    });
+
+    auto r_strict = BENCHMARK("Strict::Start + Stop", {
+        Latte::Strict::Start("BenchStrict");
+        Latte::Strict::Stop(nullptr);
+    });
+
+    keep(r_fast, "core", 0, r_baseline->med);
+    keep(r_mid, "core", 0, r_baseline->med);
+    keep(r_hard, "core", 0, r_baseline->med);
+    keep(r_lean, "core", 0, r_baseline->med);
+    keep(r_strict, "core", 0, r_baseline->med);
+    out << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
 
 
     auto r_pulse = BENCHMARK("LATTE_PULSE (Loop)", {
         LATTE_PULSE("BenchPulse");
     });
-    PrintResult(*r_pulse, r_baseline->med);
-    std::cout << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+    keep(r_pulse, "core", 0, r_baseline->med);
+    out << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
 
 
     auto r_chrono = BENCHMARK("std::chrono::now()", {
          auto t1 = std::chrono::high_resolution_clock::now();
          auto cd = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t1).count();
+         do_not_optimize(cd);
     });
-    PrintResult(*r_chrono, r_baseline->med);
-    std::cout << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+    keep(r_chrono, "core", 0, r_baseline->med);
+    out << "+-------------------------+----------+----------+----------+----------+----------+----------+----------+" << std::endl;
+
+
+    // Scaling scenarios ---------------------------------------------------------------------------------------------
+    // 1. Live ID count: Start(ID) walks the per-thread map, Start(Slot) indexes the dense table
+    std::vector<std::string>& names = IdNames(cfg.ids);
+    std::vector<Latte::Slot> slots;
+    for (int i = 0; i < cfg.ids; ++i) slots.push_back(Latte::Register(names[i].c_str()));
+    for (int n = 1; ; n = std::min(n * 16, cfg.ids)) {
+        const int iters = ITERATIONS / 10;
+        for (int i = 0; i < n; ++i) { Latte::Fast::Start(names[i].c_str()); Latte::Fast::Stop(nullptr); } // touch outside the window
+        own(Measure("IDs=" + std::to_string(n) + " Start(ID)", iters, SAMPLES, 1, [&](int i) {
+            Latte::Fast::Start(names[(unsigned)i % (unsigned)n].c_str());
+            Latte::Fast::Stop(nullptr);
+        }), "ids_map", n, base);
+        own(Measure("IDs=" + std::to_string(n) + " Start(Slot)", iters, SAMPLES, 1, [&](int i) {
+            Latte::Fast::Start(slots[(unsigned)i % (unsigned)n]);
+            Latte::Fast::Stop(nullptr);
+        }), "ids_slot", n, base);
+        if (n == cfg.ids) break;
+    }
+    out << SEP << std::endl;
 
-    Latte::DumpToStream(std::cout, Latte::Parameter::Cycle, Latte::Parameter::Calibrated);
+    // 2. Nesting depth: d Starts then d Stops, cost reported per Start+Stop pair
+    for (int d = 1; ; d = std::min(d * 4, cfg.depth)) {
+        own(Measure("Depth=" + std::to_string(d), ITERATIONS / 10, SAMPLES, d, [&](int) {
+            for (int k = 0; k < d; ++k) Latte::Fast::Start(slots[(unsigned)k % slots.size()]);
+            for (int k = 0; k < d; ++k) Latte::Fast::Stop(nullptr);
+        }), "depth", d, base);
+        if (d == cfg.depth) break;
+    }
+    out << SEP << std::endl;
+
+    // 3. First touch: first Start/Stop on an ID the thread never saw (map insert, ring carve, page faults)
+    for (Latte::Parameter::Backing b : {Latte::Parameter::Lazy, Latte::Parameter::Populate}) {
+        Latte::Manager::Get().backing = b;
+        std::unique_ptr<BenchResult> r;
+        std::thread([&] {
+            PinThread(cfg.core);
+            std::vector<double> samples;
+            for (int i = 0; i < cfg.ids; ++i) {
+                const char* id = names[i].c_str();
+                const uint64_t start = rdtsc_begin();
+                Latte::Fast::Start(id);
+                Latte::Fast::Stop(nullptr);
+                samples.push_back((double)(rdtsc_end() - start));
+            }
+            r = Summarize(samples, b == Latte::Parameter::Lazy ? "First touch (Lazy)" : "First touch (Populate)");
+        }).join();
+        own(std::move(r), "first_touch", cfg.ids, base);
+    }
+    Latte::Manager::Get().backing = Latte::Parameter::Lazy;
+    out << SEP << std::endl;
+
+    // 4. Measurement variance per mode: deltas recorded around the same dependent multiply chain (cycles per pair,
+    //    not per op). A tighter StdDev / Delta means less reordering across the reads; Min shows the overhead kept in
+    constexpr int CHAIN = 64;
+    auto chain = [] {
+        uint64_t x = 3;
+        for (int k = 0; k < CHAIN; ++k) { x *= 0x9E3779B97F4A7C15ull; asm volatile("" : "+r"(x)); }
+        do_not_optimize(x);
+    };
+    auto variance = [&](const char* name, long mode, auto start, auto stop) {
+        std::vector<double> deltas(ITERATIONS / 10);
+        for (int w = 0; w < 1000; ++w) { start(); chain(); stop(); }
+        for (double& d : deltas) { start(); chain(); d = (double)stop(); }
+        own(Summarize(deltas, name), "mode_variance", mode, 0);
+    };
+    variance("Var Fast (64 imul)", (long)Latte::Mode::Fast,
+             [] { Latte::Fast::Start("VarFast"); }, [] { return Latte::Fast::R::Stop(nullptr); });
+    variance("Var Mid (64 imul)", (long)Latte::Mode::Mid,
+             [] { Latte::Mid::Start("VarMid"); }, [] { return Latte::Mid::R::Stop(nullptr); });
+    variance("Var Hard (64 imul)", (long)Latte::Mode::Hard,
+             [] { Latte::Hard::Start("VarHard"); }, [] { return Latte::Hard::R::Stop(nullptr); });
+    variance("Var Lean (64 imul)", (long)Latte::Mode::Lean,
+             [] { Latte::Lean::Start("VarLean"); }, [] { return Latte::Lean::R::Stop(nullptr); });
+    variance("Var Strict (64 imul)", (long)Latte::Mode::Strict,
+             [] { Latte::Strict::Start("VarStrict"); }, [] { return Latte::Strict::R::Stop(nullptr); });
+    out << SEP << std::endl;
+
+    // 5. N recording threads while another thread keeps calling DumpToStream
+    const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 1; ; t = std::min(t * 2, cfg.threads)) {
+        std::atomic<bool> stop{false};
+        std::atomic<long> dumps{0};
+        std::thread dumper([&] {
+            std::ostream sink(nullptr);
+            while (!stop.load(std::memory_order_relaxed)) {
+                Latte::DumpToStream(sink, Latte::Parameter::Cycle, Latte::Parameter::Calibrated);
+                dumps.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        std::vector<std::unique_ptr<BenchResult>> per(t);
+        std::vector<std::thread> workers;
+        for (int w = 0; w < t; ++w) {
+            workers.emplace_back([&, w] {
+                PinThread((int)((unsigned)(cfg.core + w) % cpus));
+                per[w] = Measure("", ITERATIONS / 10, SAMPLES, 1, [](int) {
+                    Latte::Fast::Start("BenchThreads");
+                    Latte::Fast::Stop(nullptr);
+                });
+            });
+        }
+        for (std::thread& w : workers) w.join();
+        stop.store(true);
+        dumper.join();
+        // Per-thread medians folded into one row: avg of medians, worst thread as Max
+        std::vector<double> meds;
+        for (auto& r : per) meds.push_back(r->med);
+        auto r = Summarize(meds, "Threads=" + std::to_string(t) + " dumps=" + std::to_string(dumps.load()));
+        r->max = 0;
+        for (auto& p : per) r->max = std::max(r->max, p->max);
+        own(std::move(r), "threads", t, base);
+        if (t == cfg.threads) break;
+    }
+    out << SEP << std::endl;
+
+    if (table) {
+        Latte::DumpToStream(std::cout, Latte::Parameter::Cycle, Latte::Parameter::Calibrated);
+    } else if (cfg.out.empty()) {
+        WriteMachineReadable(std::cout, cfg.format, rows);
+    } else {
+        std::ofstream f(cfg.out);
+        WriteMachineReadable(f, cfg.format, rows);
+    }
 
     return 0;
 }
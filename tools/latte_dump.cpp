@@ -0,0 +1,31 @@
+// g++ -O3 -std=c++17 -I.. latte_dump.cpp -o latte_dump -lpthread
+// Offline report for trace files produced by Latte::WriteTrace / Latte::TraceWriter
+#include <cstring>
+#include <iostream>
+
+#include "Latte.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <trace.bin> [--cycles] [--raw]\n";
+        return 2;
+    }
+
+    Latte::Parameter::Unit unit = Latte::Parameter::Time;
+    Latte::Parameter::Data data = Latte::Parameter::Calibrated;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cycles") == 0) unit = Latte::Parameter::Cycle;
+        else if (std::strcmp(argv[i], "--raw") == 0) data = Latte::Parameter::Raw;
+    }
+
+    Latte::Trace trace;
+    if (!trace.Open(argv[1])) {
+        std::cerr << "latte_dump: cannot read trace '" << argv[1] << "'\n";
+        return 1;
+    }
+
+    std::cout << argv[1] << ": " << trace.blocks.size() << " blocks, " << trace.ids.size() << " ids, "
+              << trace.thread_count << " threads, " << trace.cycles_per_ns << " cycles/ns\n";
+    Latte::DumpToStream(std::cout, trace, unit, data);
+    return 0;
+}
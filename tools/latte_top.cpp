@@ -0,0 +1,39 @@
+// g++ -O3 -std=c++17 -I.. latte_top.cpp -o latte_top -lpthread
+// Scrapes a Latte::Exporter shared-memory table (default "/latte") and prints it every second
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+#include "Latte.hpp"
+
+int main(int argc, char** argv) {
+    const char* name = "/latte";
+    bool once = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--once") == 0) once = true;
+        else name = argv[i];
+    }
+
+    for (;;) {
+        Latte::ExportHeader header;
+        std::vector<Latte::ExportRow> rows;
+        if (!Latte::ReadExport(name, header, rows)) {
+            std::cerr << "latte_top: no export table '" << name << "'\n";
+            return 1;
+        }
+
+        std::cout << name << ": " << rows.size() << " ids, window " << Latte::FormatTime((double)header.window_ns) << "\n";
+        std::cout << std::left << std::setw(24) << "ID" << std::right
+                  << std::setw(10) << "COUNT" << std::setw(12) << "AVG" << std::setw(12) << "P50"
+                  << std::setw(12) << "P99" << std::setw(12) << "P99.9" << std::setw(12) << "MAX" << std::setw(10) << "LOST" << "\n";
+        for (const Latte::ExportRow& r : rows) {
+            std::cout << std::left << std::setw(24) << std::string(r.name, strnlen(r.name, sizeof(r.name))).substr(0, 23) << std::right
+                      << std::setw(10) << r.count << std::setw(12) << Latte::FormatTime(r.avg) << std::setw(12) << Latte::FormatTime(r.p50)
+                      << std::setw(12) << Latte::FormatTime(r.p99) << std::setw(12) << Latte::FormatTime(r.p999)
+                      << std::setw(12) << Latte::FormatTime(r.max) << std::setw(10) << r.lost << "\n";
+        }
+        if (once) return 0;
+        std::cout << std::endl;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}